@@ -0,0 +1,77 @@
+#include "OscAddressTable.h"
+
+#include <string.h>
+
+#define OSC_ADDRESS_TABLE_SIZE 4096
+
+
+OscAddressTable::OscAddressTable(uint32_t maxAddresses) : maxEntries(maxAddresses < MAX_CAPACITY ? maxAddresses : MAX_CAPACITY), count(0) {
+    // keep the slot table at most half full so probe sequences stay short.
+    // maxEntries * 2 is at most 2^31, so numSlots cannot overflow
+    uint32_t numSlots = 2;
+    while (numSlots < maxEntries * 2) numSlots <<= 1;
+    slotMask = numSlots - 1;
+    slots = new std::atomic<uint32_t>[numSlots];
+    for (uint32_t i = 0; i < numSlots; i++) slots[i].store(0, std::memory_order_relaxed);
+    entries = new Entry[maxEntries];
+}
+
+OscAddressTable::~OscAddressTable() {
+    delete[] slots;
+    delete[] entries;
+}
+
+uint32_t OscAddressTable::probe(const char* address, uint32_t hash, uint32_t* id) const {
+    uint32_t i = hash & slotMask;
+    while (true) {
+        // the acquire load pairs with the release store in intern(),
+        // the entry is fully written before its slot is visible
+        uint32_t value = slots[i].load(std::memory_order_acquire);
+        if (value == 0) {
+            *id = INVALID_ID;
+            return i;
+        }
+        const Entry& entry = entries[value - 1];
+        if (entry.hash == hash && strcmp(entry.address, address) == 0) {
+            *id = value - 1;
+            return i;
+        }
+        i = (i + 1) & slotMask;
+    }
+}
+
+uint32_t OscAddressTable::find(const char* address, uint32_t hash) const {
+    uint32_t id;
+    probe(address, hash, &id);
+    return id;
+}
+
+uint32_t OscAddressTable::intern(const char* address, uint32_t hash) {
+    uint32_t id = find(address, hash);
+    if (id != INVALID_ID) return id;
+    if (strlen(address) >= MAX_ADDRESS_LENGTH) return INVALID_ID;
+
+    std::lock_guard<std::mutex> lock(insertMutex);
+    // probe again, another thread may have added the address meanwhile
+    uint32_t slot = probe(address, hash, &id);
+    if (id != INVALID_ID) return id;
+    id = count.load(std::memory_order_relaxed);
+    if (id >= maxEntries) return INVALID_ID;
+
+    Entry& entry = entries[id];
+    entry.hash = hash;
+    strcpy(entry.address, address);
+    count.store(id + 1, std::memory_order_release);
+    slots[slot].store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const char* OscAddressTable::getAddress(uint32_t id) const {
+    if (id >= count.load(std::memory_order_acquire)) return nullptr;
+    return entries[id].address;
+}
+
+OscAddressTable& OscAddressTable::global() {
+    static OscAddressTable table(OSC_ADDRESS_TABLE_SIZE);
+    return table;
+}
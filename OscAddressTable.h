@@ -0,0 +1,61 @@
+#pragma once
+
+#include "tinyosc.h"
+#include <atomic>
+#include <mutex>
+
+// Maps each distinct OSC address to a stable 32-bit id.
+// Lookups are lock-free and can run concurrently with insertions.
+// The table holds at most a fixed number of addresses, once it is full
+// unknown addresses get INVALID_ID, so that senders cannot exhaust memory.
+// Addresses are never removed, so a table which interns addresses straight
+// from the wire can be filled for good by a sender making up addresses.
+class OscAddressTable {
+public:
+
+	static const uint32_t INVALID_ID = 0xFFFFFFFF;
+	static const int MAX_ADDRESS_LENGTH = 128;
+	static const uint32_t MAX_CAPACITY = 1u << 30; // larger capacities are clamped to this
+
+	OscAddressTable(uint32_t maxAddresses);
+	~OscAddressTable();
+
+	OscAddressTable(const OscAddressTable&) = delete;
+	OscAddressTable& operator=(const OscAddressTable&) = delete;
+
+	// returns the id of the address, adding it to the table if needed
+	uint32_t intern(const char* address) { return intern(address, tosc_hashAddress(address)); }
+	uint32_t intern(const char* address, uint32_t hash);
+
+	// returns the id of the address, or INVALID_ID if it is not in the table
+	uint32_t find(const char* address) const { return find(address, tosc_hashAddress(address)); }
+	uint32_t find(const char* address, uint32_t hash) const;
+
+	// returns the address of an id, or nullptr if the id is unknown
+	const char* getAddress(uint32_t id) const;
+
+	uint32_t size() const { return count.load(std::memory_order_acquire); }
+	uint32_t capacity() const { return maxEntries; }
+
+	// the table used by OscMessage. Parsed messages only look their address up,
+	// addresses are added by OscMessage::registerAddress, so that the ids the
+	// application handles cannot be crowded out by addresses it never asked for
+	static OscAddressTable& global();
+
+private:
+
+	struct Entry {
+		uint32_t hash;
+		char address[MAX_ADDRESS_LENGTH];
+	};
+
+	// returns the slot holding the address, or the empty slot ending its probe sequence
+	uint32_t probe(const char* address, uint32_t hash, uint32_t* id) const;
+
+	std::atomic<uint32_t>* slots; // id + 1 of the entry, 0 if empty. Indexed by hash
+	uint32_t slotMask;
+	Entry* entries; // indexed by id, never modified once published
+	uint32_t maxEntries;
+	std::atomic<uint32_t> count;
+	std::mutex insertMutex;
+};
@@ -0,0 +1,221 @@
+#include "OscAsync.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// seconds between the NTP epoch (1900) and the unix epoch (1970)
+#define NTP_UNIX_OFFSET 2208988800ULL
+
+
+static uint64_t timetagToNanoseconds(uint64_t timetag) {
+    uint64_t seconds = timetag >> 32;
+    if (seconds < NTP_UNIX_OFFSET) return 0;
+    uint64_t fraction = ((timetag & 0xFFFFFFFFULL) * 1000000000ULL) >> 32;
+    return (seconds - NTP_UNIX_OFFSET) * 1000000000ULL + fraction;
+}
+
+static uint64_t nowNanoseconds() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+void OscTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+    // the loop destroys the frame once control is back in run()
+    handle.promise().loop->finished.push_back(handle);
+}
+
+
+OscEventLoop::OscEventLoop() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epollFd >= 0 && timerFd >= 0 && watch(timerFd, nullptr)) return;
+    if (timerFd >= 0) close(timerFd);
+    if (epollFd >= 0) close(epollFd);
+    timerFd = -1;
+    epollFd = -1;
+}
+
+OscEventLoop::~OscEventLoop() {
+    // coroutines still waiting for I/O or a timer are never resumed
+    for (void* address : tasks) std::coroutine_handle<>::from_address(address).destroy();
+    if (timerFd >= 0) close(timerFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+void OscEventLoop::spawn(OscTask task) {
+    auto handle = task.handle;
+    task.handle = nullptr; // the loop owns the coroutine from now on
+    handle.promise().loop = this;
+    tasks.insert(handle.address());
+    schedule(handle);
+}
+
+bool OscEventLoop::watch(int fd, void* owner) {
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.ptr = owner;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void OscEventLoop::unwatch(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+OscEventLoop::TimerAwaiter OscEventLoop::waitUntil(uint64_t timetag) {
+    return TimerAwaiter{ *this, timetag == TINYOSC_TIMETAG_IMMEDIATELY ? 0 : timetagToNanoseconds(timetag) };
+}
+
+bool OscEventLoop::TimerAwaiter::await_ready() {
+    return deadline <= nowNanoseconds();
+}
+
+void OscEventLoop::TimerAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    loop.timers.push({ deadline, loop.timerSequence++, handle });
+    loop.armTimer();
+}
+
+void OscEventLoop::armTimer() {
+    uint64_t deadline = timers.empty() ? 0 : timers.top().deadline;
+    if (deadline == armedDeadline) return;
+    armedDeadline = deadline;
+    itimerspec spec = {};
+    // a zero it_value disarms the timer
+    spec.it_value.tv_sec = deadline / 1000000000ULL;
+    spec.it_value.tv_nsec = deadline % 1000000000ULL;
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void OscEventLoop::fireTimers() {
+    uint64_t expirations;
+    while (read(timerFd, &expirations, sizeof(expirations)) > 0) {}
+    uint64_t now = nowNanoseconds();
+    while (!timers.empty() && timers.top().deadline <= now) {
+        schedule(timers.top().handle);
+        timers.pop();
+    }
+    armedDeadline = 0; // the timerfd has expired
+    armTimer();
+}
+
+void OscEventLoop::run() {
+    stopping = false;
+    if (!isOpen()) return;
+    epoll_event events[64];
+    while (!stopping && !tasks.empty()) {
+        while (!ready.empty() && !stopping) {
+            auto handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+            for (auto done : finished) {
+                tasks.erase(done.address());
+                done.destroy();
+            }
+            finished.clear();
+        }
+        if (stopping || tasks.empty()) break;
+
+        int n = epoll_wait(epollFd, events, 64, -1);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == nullptr) fireTimers();
+            else ((OscSocket*)events[i].data.ptr)->onEvent(events[i].events);
+        }
+    }
+}
+
+
+OscSocket::OscSocket(OscEventLoop& l, uint16_t port) : loop(l), buffers(BATCH_SIZE * BUFFER_SIZE) {
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = errno;
+        return;
+    }
+    sockaddr_in sin = {};
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = INADDR_ANY;
+    if (bind(fd, (sockaddr*)&sin, sizeof(sin)) != 0 || !loop.isOpen() || !loop.watch(fd, this)) {
+        error = loop.isOpen() ? errno : EBADF;
+        close(fd);
+        fd = -1;
+    }
+}
+
+OscSocket::~OscSocket() {
+    if (fd < 0) return;
+    loop.unwatch(fd);
+    close(fd);
+}
+
+uint16_t OscSocket::getPort() {
+    sockaddr_in sin = {};
+    socklen_t length = sizeof(sin);
+    getsockname(fd, (sockaddr*)&sin, &length);
+    return ntohs(sin.sin_port);
+}
+
+bool OscSocket::tryReceive() {
+    mmsghdr messages[BATCH_SIZE];
+    iovec iovecs[BATCH_SIZE];
+    sockaddr_in sources[BATCH_SIZE];
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        iovecs[i].iov_base = buffers.data() + i * BUFFER_SIZE;
+        iovecs[i].iov_len = BUFFER_SIZE;
+        memset(&messages[i], 0, sizeof(mmsghdr));
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &sources[i];
+        messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    int n = recvmmsg(fd, messages, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+    if (n <= 0) return false;
+
+    views.clear();
+    for (int i = 0; i < n; i++) {
+        char* buffer = buffers.data() + i * BUFFER_SIZE;
+        int length = (int)messages[i].msg_len;
+        OscMessageView view;
+        view.source = sources[i];
+        if (length >= 16 && tosc_isBundle(buffer)) {
+            tosc_bundle bundle;
+            tosc_parseBundle(&bundle, buffer, length);
+            view.timetag = tosc_getTimetag(&bundle);
+            while (tosc_getNextMessage(&bundle, &view.message)) views.push_back(view);
+        }
+        else if (length > 0 && 0 == tosc_parseMessage(&view.message, buffer, length)) {
+            view.timetag = TINYOSC_TIMETAG_IMMEDIATELY;
+            views.push_back(view);
+        }
+    }
+    return true;
+}
+
+bool OscSocket::trySend(SendAwaiter& awaiter) {
+    // keep the order of sends, don't overtake waiting senders
+    if (!senders.empty() && senders.front() != &awaiter) return false;
+    int result = (int)sendto(fd, awaiter.buffer, awaiter.length, MSG_DONTWAIT, (sockaddr*)&awaiter.destination, sizeof(sockaddr_in));
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+    awaiter.result = result;
+    return true;
+}
+
+void OscSocket::onEvent(uint32_t events) {
+    if ((events & EPOLLIN) && receiver && tryReceive()) {
+        loop.schedule(receiver);
+        receiver = nullptr;
+    }
+    if (events & EPOLLOUT) {
+        while (!senders.empty() && trySend(*senders.front())) {
+            loop.schedule(senders.front()->handle);
+            senders.pop_front();
+        }
+    }
+}
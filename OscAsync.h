@@ -0,0 +1,187 @@
+#pragma once
+
+// Coroutine based receiving and sending of OSC on a single-threaded epoll event loop.
+// Requires C++20 and Linux.
+
+#include "tinyosc.h"
+#include <coroutine>
+#include <deque>
+#include <netinet/in.h>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+class OscEventLoop;
+
+// a parsed message pointing into the receive buffer of its socket,
+// valid until the next receive() on that socket
+struct OscMessageView {
+	tosc_message message;
+	uint64_t timetag; // the timetag of the enclosing bundle, TINYOSC_TIMETAG_IMMEDIATELY for plain messages
+	sockaddr_in source;
+};
+
+// a coroutine started with OscEventLoop::spawn(), destroyed by the loop when it returns
+class OscTask {
+public:
+	struct promise_type {
+		OscEventLoop* loop = nullptr;
+		OscTask get_return_object() { return OscTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		struct FinalAwaiter {
+			bool await_ready() noexcept { return false; }
+			void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+			void await_resume() noexcept {}
+		};
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { throw; }
+	};
+
+	OscTask(OscTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+	~OscTask() { if (handle) handle.destroy(); }
+
+	OscTask(const OscTask&) = delete;
+	OscTask& operator=(const OscTask&) = delete;
+
+private:
+	friend class OscEventLoop;
+	explicit OscTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+	std::coroutine_handle<promise_type> handle;
+};
+
+class OscEventLoop {
+public:
+
+	OscEventLoop();
+	~OscEventLoop();
+
+	// false if the epoll instance or the timer could not be created, run() then returns at once
+	bool isOpen() const { return epollFd >= 0 && timerFd >= 0; }
+
+	OscEventLoop(const OscEventLoop&) = delete;
+	OscEventLoop& operator=(const OscEventLoop&) = delete;
+
+	// starts a coroutine on the next iteration of the loop
+	void spawn(OscTask task);
+
+	// runs until stop() is called or all spawned coroutines have returned
+	void run();
+	void stop() { stopping = true; }
+
+	struct TimerAwaiter {
+		OscEventLoop& loop;
+		uint64_t deadline; // nanoseconds since the unix epoch
+		bool await_ready();
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() {}
+	};
+
+	// suspends until the wall clock reaches an OSC timetag, e.g. the timetag of a bundle.
+	// TINYOSC_TIMETAG_IMMEDIATELY and timetags in the past resume immediately
+	TimerAwaiter waitUntil(uint64_t timetag);
+
+private:
+
+	friend class OscSocket;
+	friend struct OscTask::promise_type::FinalAwaiter;
+
+	struct Timer {
+		uint64_t deadline;
+		uint64_t sequence; // keeps timers with the same deadline in order
+		std::coroutine_handle<> handle;
+		bool operator>(const Timer& other) const { return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence; }
+	};
+
+	void schedule(std::coroutine_handle<> handle) { ready.push_back(handle); }
+	bool watch(int fd, void* owner); // returns false on error
+	void unwatch(int fd);
+	void armTimer();
+	void fireTimers();
+
+	int epollFd;
+	int timerFd;
+	bool stopping = false;
+	uint64_t timerSequence = 0;
+	uint64_t armedDeadline = 0;
+	std::deque<std::coroutine_handle<>> ready;
+	std::vector<std::coroutine_handle<>> finished;
+	std::unordered_set<void*> tasks; // frames of all running coroutines, by address
+	std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+};
+
+// a non-blocking UDP socket registered with an event loop.
+// One coroutine at a time may wait in receive(), any number may wait in send()
+class OscSocket {
+public:
+
+	static const int BATCH_SIZE = 32; // datagrams read per system call
+	static const int BUFFER_SIZE = 2048; // the largest datagram received
+
+	// binds to the given port, 0 picks a free port. Check isOpen() before use
+	OscSocket(OscEventLoop& loop, uint16_t port = 0);
+	~OscSocket();
+
+	// false if the socket could not be created or bound, e.g. because the port is in use.
+	// receive() then returns an empty batch and send() -1, without waiting
+	bool isOpen() const { return fd >= 0; }
+
+	// the errno of the call which failed when the socket was opened, 0 if it is open
+	int getError() const { return error; }
+
+	OscSocket(const OscSocket&) = delete;
+	OscSocket& operator=(const OscSocket&) = delete;
+
+	struct ReceiveAwaiter {
+		OscSocket& socket;
+		bool await_ready() {
+			// closed, or another coroutine is already waiting
+			if (!socket.isOpen() || socket.receiver) {
+				socket.views.clear();
+				return true;
+			}
+			return socket.tryReceive();
+		}
+		void await_suspend(std::coroutine_handle<> handle) { socket.receiver = handle; }
+		const std::vector<OscMessageView>& await_resume() { return socket.views; }
+	};
+
+	struct SendAwaiter {
+		OscSocket& socket;
+		const char* buffer;
+		int length;
+		sockaddr_in destination;
+		int result = -1;
+		std::coroutine_handle<> handle;
+		bool await_ready() { return socket.trySend(*this); }
+		void await_suspend(std::coroutine_handle<> h) { handle = h; socket.senders.push_back(this); }
+		int await_resume() { return result; }
+	};
+
+	// suspends until at least one datagram has arrived, and returns all messages
+	// of the datagrams read in one batch, with bundles unpacked.
+	// While another coroutine is waiting here, returns an empty batch at once
+	ReceiveAwaiter receive() { return ReceiveAwaiter{ *this }; }
+
+	// suspends until the packet could be handed to the kernel. Returns the number of bytes sent, -1 on error
+	SendAwaiter send(const char* buffer, int length, const sockaddr_in& destination) { return SendAwaiter{ *this, buffer, length, destination, -1, nullptr }; }
+
+	int getFd() { return fd; }
+	uint16_t getPort();
+
+private:
+
+	friend class OscEventLoop;
+
+	bool tryReceive();
+	bool trySend(SendAwaiter& awaiter);
+	void onEvent(uint32_t events);
+
+	OscEventLoop& loop;
+	int fd;
+	int error = 0;
+	std::vector<char> buffers; // BATCH_SIZE datagrams of BUFFER_SIZE bytes
+	std::vector<OscMessageView> views;
+	std::coroutine_handle<> receiver;
+	std::deque<SendAwaiter*> senders;
+};
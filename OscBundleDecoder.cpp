@@ -0,0 +1,198 @@
+#include "OscBundleDecoder.h"
+
+#include <algorithm>
+#include <string.h>
+#if _WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+
+OscBundleDecoder::OscBundleDecoder(int numThreads) {
+    if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+    if (numThreads <= 0) numThreads = 1;
+    for (int i = 0; i < numThreads; i++) queues.push_back(std::make_unique<Queue>());
+    for (int i = 1; i < numThreads; i++) workers.emplace_back(&OscBundleDecoder::workerLoop, this, i);
+}
+
+OscBundleDecoder::~OscBundleDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobStarted.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+bool OscBundleDecoder::scan(char* buffer, size_t size, std::vector<Element>& elements) {
+    if (size < 16 || !tosc_isBundle(buffer)) {
+        elements.push_back({ 0, (uint32_t)size });
+        return true;
+    }
+    // nested bundles are entered in place rather than recursively, so that
+    // deeply nested input cannot overflow the stack. ends holds the end of
+    // each enclosing bundle
+    std::vector<size_t> ends;
+    size_t end = size;
+    size_t i = 16; // skip '#bundle ' and the timetag
+    while (true) {
+        if (i + 4 > end) {
+            if (ends.empty()) return true;
+            // continue after the nested bundle in the enclosing one
+            i = end;
+            end = ends.back();
+            ends.pop_back();
+            continue;
+        }
+        uint32_t len;
+        memcpy(&len, buffer + i, 4);
+        len = ntohl(len);
+        i += 4;
+        if (len > end - i) return false;
+        if (len >= 16 && tosc_isBundle(buffer + i)) {
+            ends.push_back(end);
+            end = i + len;
+            i += 16;
+        }
+        else {
+            elements.push_back({ (uint32_t)i, len });
+            i += len;
+        }
+    }
+}
+
+uint64_t OscBundleDecoder::getPacketTimetag(char* buffer, size_t size) {
+    if (size < 16 || !tosc_isBundle(buffer)) return 0;
+    tosc_bundle bundle;
+    tosc_parseBundle(&bundle, buffer, (int)size);
+    return tosc_getTimetag(&bundle);
+}
+
+std::vector<std::shared_ptr<OscMessage>> OscBundleDecoder::decode(char* buffer, size_t size) {
+    std::vector<std::shared_ptr<OscMessage>> output;
+    decode(buffer, size, [&output](std::shared_ptr<OscMessage> message) { output.push_back(std::move(message)); }, true);
+    return output;
+}
+
+bool OscBundleDecoder::decode(char* buffer, size_t size, const Handler& handler, bool ordered) {
+    std::vector<Element> elements;
+    bool ok = scan(buffer, size, elements);
+    uint64_t timetag = getPacketTimetag(buffer, size);
+
+    if (workers.empty() || elements.size() < parallelThreshold) {
+        for (auto& element : elements) handler(std::make_shared<OscMessage>(buffer + element.offset, element.size, timetag));
+        return ok;
+    }
+
+    std::vector<std::shared_ptr<OscMessage>> results;
+    if (ordered) results.resize(elements.size());
+
+    Job newJob;
+    newJob.buffer = buffer;
+    newJob.timetag = timetag;
+    newJob.elements = &elements;
+    newJob.results = ordered ? &results : nullptr;
+    newJob.handler = ordered ? nullptr : &handler;
+    newJob.numChunks = (elements.size() + chunkSize - 1) / chunkSize;
+    newJob.remainingChunks.store(newJob.numChunks);
+
+    // the pool runs one job at a time, concurrent calls wait here for their turn
+    std::unique_lock<std::mutex> decodeLock(decodeMutex);
+
+    // hand each thread a contiguous range of chunks, idle threads steal from the others
+    size_t numQueues = queues.size();
+    for (size_t q = 0; q < numQueues; q++) {
+        size_t begin = newJob.numChunks * q / numQueues;
+        size_t end = newJob.numChunks * (q + 1) / numQueues;
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        for (size_t c = begin; c < end; c++) queues[q]->chunks.push_back(c);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &newJob;
+        jobGeneration++;
+    }
+    jobStarted.notify_all();
+
+    runChunks(0);
+
+    {
+        // wait until all chunks are done and no worker still refers to the job
+        std::unique_lock<std::mutex> lock(mutex);
+        jobFinished.wait(lock, [&] { return newJob.remainingChunks.load() == 0 && activeWorkers == 0; });
+        job = nullptr;
+    }
+    decodeLock.unlock();
+
+    if (ordered) {
+        for (auto& message : results) handler(std::move(message));
+    }
+    return ok;
+}
+
+void OscBundleDecoder::workerLoop(int index) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobStarted.wait(lock, [&] { return stopping || (job != nullptr && jobGeneration != seenGeneration); });
+            if (stopping) return;
+            seenGeneration = jobGeneration;
+            activeWorkers++;
+        }
+        runChunks(index);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+        jobFinished.notify_all();
+    }
+}
+
+void OscBundleDecoder::runChunks(int index) {
+    size_t chunk;
+    while (popChunk(index, &chunk)) {
+        processChunk(chunk);
+        if (job->remainingChunks.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobFinished.notify_all();
+        }
+    }
+}
+
+bool OscBundleDecoder::popChunk(int index, size_t* chunk) {
+    // take from the front of our own queue
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.chunks.empty()) {
+            *chunk = own.chunks.front();
+            own.chunks.pop_front();
+            return true;
+        }
+    }
+    // steal from the back of the other queues
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.chunks.empty()) {
+            *chunk = victim.chunks.back();
+            victim.chunks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void OscBundleDecoder::processChunk(size_t chunk) {
+    const std::vector<Element>& elements = *job->elements;
+    size_t begin = chunk * chunkSize;
+    size_t end = std::min(begin + chunkSize, elements.size());
+    for (size_t i = begin; i < end; i++) {
+        auto message = std::make_shared<OscMessage>(job->buffer + elements[i].offset, elements[i].size, job->timetag);
+        if (job->results != nullptr) (*job->results)[i] = std::move(message);
+        else (*job->handler)(std::move(message));
+    }
+}
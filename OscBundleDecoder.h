@@ -0,0 +1,89 @@
+#pragma once
+
+#include "OscMessage.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decodes very large bundles (e.g. full state dumps) on several threads.
+// A fast sequential pass collects the offset of every message from the
+// element length prefixes, then a work-stealing pool parses the messages.
+class OscBundleDecoder {
+public:
+
+	struct Element {
+		uint32_t offset; // offset of the message in the packet
+		uint32_t size; // length of the message
+	};
+
+	typedef std::function<void(std::shared_ptr<OscMessage>)> Handler;
+
+	// numThreads includes the calling thread, 0 uses all cores
+	OscBundleDecoder(int numThreads = 0);
+	~OscBundleDecoder();
+
+	OscBundleDecoder(const OscBundleDecoder&) = delete;
+	OscBundleDecoder& operator=(const OscBundleDecoder&) = delete;
+
+	// collects the messages of a packet, descending into nested bundles.
+	// Returns false if an element length exceeds the packet
+	static bool scan(char* buffer, size_t size, std::vector<Element>& elements);
+
+	// decodes all messages of a packet, in order
+	std::vector<std::shared_ptr<OscMessage>> decode(char* buffer, size_t size);
+
+	// decodes all messages of a packet and passes them to handler.
+	// When ordered, handler is called on the calling thread in packet order,
+	// otherwise it is called concurrently from the pool threads as soon as each message is parsed.
+	// Returns false if the packet is malformed, messages before the error are still handled.
+	// Calls from several threads share the pool and take turns. An unordered handler
+	// must not call decode() on the same decoder, it would wait for its own job to end
+	bool decode(char* buffer, size_t size, const Handler& handler, bool ordered);
+
+	int getThreadCount() { return (int)workers.size() + 1; }
+
+	// bundles with fewer messages are decoded on the calling thread
+	size_t parallelThreshold = 256;
+	// number of messages per unit of work
+	size_t chunkSize = 64;
+
+private:
+
+	struct Job {
+		char* buffer;
+		uint64_t timetag; // of the outermost bundle, 0 for a single message
+		const std::vector<Element>* elements;
+		std::vector<std::shared_ptr<OscMessage>>* results; // null when unordered
+		const Handler* handler; // null when ordered
+		size_t numChunks;
+		std::atomic<size_t> remainingChunks;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<size_t> chunks;
+	};
+
+	void workerLoop(int index);
+	void runChunks(int index);
+	bool popChunk(int index, size_t* chunk);
+	void processChunk(size_t chunk);
+	static uint64_t getPacketTimetag(char* buffer, size_t size);
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues; // one per thread, the calling thread is index 0
+
+	std::mutex decodeMutex; // held by the decode() call which owns the pool
+	std::mutex mutex;
+	std::condition_variable jobStarted;
+	std::condition_variable jobFinished;
+	Job* job = nullptr;
+	uint64_t jobGeneration = 0;
+	int activeWorkers = 0;
+	bool stopping = false;
+};
@@ -0,0 +1,173 @@
+#include "OscDispatcher.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+namespace {
+
+    std::atomic<uint64_t> nextDispatcherId(1);
+
+    // the reader slots a thread holds, released when the thread exits
+    struct ThreadSlots {
+        struct Claim {
+            uint64_t dispatcherId;
+            std::shared_ptr<OscDispatcher::Readers> readers;
+            int slot;
+            int depth; // nested dispatch() calls
+        };
+        std::vector<Claim> claims;
+        ~ThreadSlots() {
+            for (auto& claim : claims) claim.readers->slots[claim.slot].used.store(false, std::memory_order_release);
+        }
+    };
+
+    thread_local ThreadSlots threadSlots;
+
+}
+
+
+void OscDispatcher::Table::build() {
+    uint32_t size = 8;
+    while (size < entries.size() * 2) size <<= 1;
+    mask = size - 1;
+    index.assign(size, -1);
+    for (int32_t i = 0; i < (int32_t)entries.size(); i++) {
+        uint32_t slot = entries[i].hash & mask;
+        while (index[slot] >= 0) slot = (slot + 1) & mask;
+        index[slot] = i;
+    }
+}
+
+const OscDispatcher::Entry* OscDispatcher::Table::find(const char* address, uint32_t hash) const {
+    for (uint32_t slot = hash & mask; index[slot] >= 0; slot = (slot + 1) & mask) {
+        const Entry& entry = entries[index[slot]];
+        if (entry.hash == hash && strcmp(entry.address.c_str(), address) == 0) return &entry;
+    }
+    return nullptr;
+}
+
+
+OscDispatcher::OscDispatcher() : globalEpoch(1), readers(std::make_shared<Readers>()), id(nextDispatcherId.fetch_add(1)) {
+    for (int i = 0; i < MAX_READERS; i++) {
+        readers->slots[i].epoch.store(0, std::memory_order_relaxed);
+        readers->slots[i].used.store(false, std::memory_order_relaxed);
+    }
+    readers->destroyed.store(false, std::memory_order_relaxed);
+    Table* table = new Table();
+    table->build();
+    current.store(table, std::memory_order_release);
+}
+
+OscDispatcher::~OscDispatcher() {
+    readers->destroyed.store(true, std::memory_order_release);
+    for (auto& r : retired) delete r.table;
+    delete current.load();
+}
+
+int OscDispatcher::acquireSlot() {
+    for (int i = 0; i < MAX_READERS; i++) {
+        bool expected = false;
+        ReaderSlot& reader = readers->slots[i];
+        if (!reader.used.load(std::memory_order_relaxed) && reader.used.compare_exchange_strong(expected, true)) return i;
+    }
+    return -1;
+}
+
+bool OscDispatcher::dispatch(tosc_message* message) {
+    ThreadSlots::Claim* claim = nullptr;
+    for (auto& c : threadSlots.claims) {
+        if (c.dispatcherId == id) { claim = &c; break; }
+    }
+    if (claim == nullptr) {
+        int slot = acquireSlot();
+        if (slot < 0) {
+            // more threads than reader slots, fall back to the writer lock
+            Handler handler;
+            {
+                std::lock_guard<std::mutex> lock(writeMutex);
+                const Entry* entry = current.load(std::memory_order_acquire)->find(tosc_getAddress(message), tosc_getAddressHash(message));
+                if (entry == nullptr) return false;
+                handler = entry->handler;
+            }
+            handler(message);
+            return true;
+        }
+        // forget the claims on destroyed dispatchers, so that threads which outlive
+        // many dispatchers don't accumulate them
+        auto& claims = threadSlots.claims;
+        claims.erase(std::remove_if(claims.begin(), claims.end(), [](const ThreadSlots::Claim& c) {
+            return c.readers->destroyed.load(std::memory_order_acquire);
+        }), claims.end());
+        claims.push_back({ id, readers, slot, 0 });
+        claim = &threadSlots.claims.back();
+    }
+
+    ReaderSlot& reader = readers->slots[claim->slot];
+    if (claim->depth++ == 0) {
+        // announce the epoch before loading the table, a writer will not free
+        // any table retired at or after this epoch while it is announced
+        reader.epoch.store(globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+    const Table* table = current.load(std::memory_order_seq_cst);
+    const Entry* entry = table->find(tosc_getAddress(message), tosc_getAddressHash(message));
+    if (entry != nullptr) entry->handler(message);
+    // handlers may dispatch again and grow the claim list, find our claim anew
+    for (auto& c : threadSlots.claims) {
+        if (c.dispatcherId == id && --c.depth == 0) reader.epoch.store(0, std::memory_order_release);
+    }
+    return entry != nullptr;
+}
+
+void OscDispatcher::add(const char* address, Handler handler) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    Table* table = new Table(*current.load(std::memory_order_acquire));
+    uint32_t hash = tosc_hashAddress(address);
+    bool replaced = false;
+    for (auto& entry : table->entries) {
+        if (entry.hash == hash && entry.address == address) {
+            entry.handler = std::move(handler);
+            replaced = true;
+            break;
+        }
+    }
+    if (!replaced) table->entries.push_back({ hash, address, std::move(handler) });
+    table->build();
+    publish(table);
+}
+
+bool OscDispatcher::remove(const char* address) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Table* old = current.load(std::memory_order_acquire);
+    uint32_t hash = tosc_hashAddress(address);
+    if (old->find(address, hash) == nullptr) return false;
+    Table* table = new Table();
+    for (auto& entry : old->entries) {
+        if (entry.hash != hash || entry.address != address) table->entries.push_back(entry);
+    }
+    table->build();
+    publish(table);
+    return true;
+}
+
+void OscDispatcher::publish(Table* table) {
+    const Table* old = current.exchange(table, std::memory_order_seq_cst);
+    // readers which may still hold the old table announced this epoch or an earlier one
+    uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+    retired.push_back({ epoch, old });
+    reclaim();
+}
+
+void OscDispatcher::reclaim() {
+    uint64_t oldestActive = UINT64_MAX;
+    for (int i = 0; i < MAX_READERS; i++) {
+        uint64_t epoch = readers->slots[i].epoch.load(std::memory_order_seq_cst);
+        if (epoch != 0 && epoch < oldestActive) oldestActive = epoch;
+    }
+    size_t kept = 0;
+    for (auto& r : retired) {
+        if (r.epoch < oldestActive) delete r.table;
+        else retired[kept++] = r;
+    }
+    retired.resize(kept);
+}
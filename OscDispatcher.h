@@ -0,0 +1,84 @@
+#pragma once
+
+#include "tinyosc.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Routes messages to handlers by exact address, handlers can be added and removed at any time.
+// Dispatching never blocks: every update builds a new immutable table and publishes it atomically.
+// Old tables are freed by epoch-based reclamation, once no reader can still be using them.
+class OscDispatcher {
+public:
+
+	typedef std::function<void(tosc_message* message)> Handler;
+
+	// the number of threads which can dispatch without ever taking a lock
+	static const int MAX_READERS = 64;
+
+	OscDispatcher();
+	~OscDispatcher(); // no thread may be dispatching
+
+	OscDispatcher(const OscDispatcher&) = delete;
+	OscDispatcher& operator=(const OscDispatcher&) = delete;
+
+	// sets the handler of an address, replacing any previous one
+	void add(const char* address, Handler handler);
+
+	// removes the handler of an address. Returns false if there was none
+	bool remove(const char* address);
+
+	// calls the handler registered for the address of the message.
+	// Handlers may add and remove handlers. Returns false if no handler matched
+	bool dispatch(tosc_message* message);
+
+	size_t size() { return current.load(std::memory_order_acquire)->entries.size(); }
+
+	// per-thread state of a dispatching thread
+	struct alignas(64) ReaderSlot {
+		std::atomic<uint64_t> epoch; // the epoch seen when entering, 0 outside of dispatch()
+		std::atomic<bool> used;
+	};
+
+	// the reader slots of a dispatcher, shared with the threads holding one, which may outlive it
+	struct Readers {
+		ReaderSlot slots[MAX_READERS];
+		std::atomic<bool> destroyed; // threads drop their claim the next time they claim a slot
+	};
+
+private:
+
+	struct Entry {
+		uint32_t hash;
+		std::string address;
+		Handler handler;
+	};
+
+	struct Table {
+		std::vector<Entry> entries;
+		std::vector<int32_t> index; // open addressing by hash, entry index or -1
+		uint32_t mask;
+		void build();
+		const Entry* find(const char* address, uint32_t hash) const;
+	};
+
+	struct Retired {
+		uint64_t epoch;
+		const Table* table;
+	};
+
+	int acquireSlot(); // returns -1 if all slots are taken
+	void publish(Table* table); // called with writeMutex held
+	void reclaim(); // called with writeMutex held
+
+	std::atomic<const Table*> current;
+	std::atomic<uint64_t> globalEpoch;
+	std::shared_ptr<Readers> readers;
+	uint64_t id; // tells apart dispatchers in the per-thread slot cache
+
+	std::mutex writeMutex;
+	std::vector<Retired> retired;
+};
@@ -0,0 +1,76 @@
+#include "OscLogSink.h"
+
+#include "tinyosc_format.h"
+#include <chrono>
+#include <string.h>
+
+// the longest line log() formats, longer messages are dropped
+#define OSC_LOG_LINE_LENGTH 1024
+
+
+OscLogSink::OscLogSink(FILE* f, size_t size, int flushIntervalMilliseconds) :
+    file(f), bufferSize(size), flushInterval(flushIntervalMilliseconds), droppedCount(0) {
+    front.reserve(bufferSize);
+    back.reserve(bufferSize);
+    writer = std::thread(&OscLogSink::writerLoop, this);
+}
+
+OscLogSink::~OscLogSink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    writer.join();
+}
+
+bool OscLogSink::log(tosc_message* message, Format format) {
+    // format on the calling thread, outside of the lock
+    char line[OSC_LOG_LINE_LENGTH];
+    int length = (format == Format::JSON)
+        ? tosc_formatMessageJson(message, line, sizeof(line))
+        : tosc_formatMessage(message, line, sizeof(line));
+    if (length < 0) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return write(line, (size_t)length);
+}
+
+bool OscLogSink::write(const char* line, size_t length) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (front.size() + length + 1 > bufferSize) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        front.insert(front.end(), line, line + length);
+        front.push_back('\n');
+        wake = front.size() > bufferSize / 2;
+    }
+    if (wake) wakeup.notify_one();
+    return true;
+}
+
+void OscLogSink::flush() {
+    wakeup.notify_one();
+}
+
+void OscLogSink::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (!stopping) wakeup.wait_for(lock, std::chrono::milliseconds(flushInterval));
+        bool stop = stopping;
+        // swap the buffers so that log() can continue while we write
+        front.swap(back);
+        lock.unlock();
+        if (!back.empty()) {
+            fwrite(back.data(), 1, back.size(), file);
+            fflush(file);
+            back.clear();
+        }
+        lock.lock();
+        if (stop && front.empty()) return;
+    }
+}
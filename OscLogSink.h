@@ -0,0 +1,54 @@
+#pragma once
+
+#include "tinyosc.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// Collects formatted log lines and writes them to a file on a background thread,
+// so that the thread receiving OSC never waits for I/O.
+// Lines are appended to a fixed-size buffer, when it is full new lines are dropped and counted.
+class OscLogSink {
+public:
+
+	enum class Format {
+		TEXT,
+		JSON
+	};
+
+	OscLogSink(FILE* file, size_t bufferSize = 1 << 16, int flushIntervalMilliseconds = 100);
+	~OscLogSink(); // writes the remaining lines and stops the background thread
+
+	OscLogSink(const OscLogSink&) = delete;
+	OscLogSink& operator=(const OscLogSink&) = delete;
+
+	// formats a message without stdio and queues it. Returns false if the line was dropped
+	bool log(tosc_message* message, Format format = Format::TEXT);
+
+	// queues a line, a newline is appended. Returns false if the line was dropped
+	bool write(const char* line, size_t length);
+
+	// wakes the background thread to write what is queued
+	void flush();
+
+	uint64_t getDroppedCount() { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+
+	void writerLoop();
+
+	FILE* file;
+	size_t bufferSize;
+	int flushInterval;
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::vector<char> front; // filled by log()
+	std::vector<char> back; // written by the background thread
+	bool stopping = false;
+	std::atomic<uint64_t> droppedCount;
+	std::thread writer;
+};
@@ -20,12 +20,13 @@
 #include "OscMessage.h"
 
 #include <iostream>
+#include <string>
 
 
-OscMessage::OscMessage(char* inputBuffer, size_t size) {
+OscMessage::OscMessage(char* inputBuffer, size_t size, uint64_t packetTimetag) : timetag(packetTimetag) {
     tosc_message message;
     if (0 == tosc_parseMessage(&message, inputBuffer, size)) {
-        strcpy(address_string, tosc_getAddress(&message));
+        setAddress(tosc_getAddress(&message), tosc_getAddressHash(&message));
         char* format = tosc_getFormat(&message);
         int argumentCount = strlen(format);
         for (int i = 0; i < argumentCount; i++) {
@@ -46,6 +47,10 @@ OscMessage::OscMessage(char* inputBuffer, size_t size) {
             case 't': arguments.push_back(new OscTimetag(tosc_getNextTimetag(&message))); break;
             case 'T': arguments.push_back(new OscBool(true)); break;
             case 'F': arguments.push_back(new OscBool(false)); break;
+            case 'c': arguments.push_back(new OscChar(tosc_getNextChar(&message))); break;
+            case 'r': arguments.push_back(new OscRgba(tosc_getNextRgba(&message))); break;
+            case '[': arguments.push_back(new OscArrayMarker(true)); break;
+            case ']': arguments.push_back(new OscArrayMarker(false)); break;
             case 'I':
             case 'N':
             default: break;
@@ -55,6 +60,15 @@ OscMessage::OscMessage(char* inputBuffer, size_t size) {
 }
 
 
+void OscMessage::setAddress(const char* address, uint32_t hash) {
+    // addresses too long to store are truncated and never get an id.
+    // Only registered addresses have one, see registerAddress()
+    tosc_strncpy(address_string, address, sizeof(address_string));
+    address_string[sizeof(address_string) - 1] = 0;
+    address_id = OscAddressTable::global().find(address, hash);
+}
+
+
 int OscMessage::getBlob(int argumentIndex, char** output) {
     OscBlob* oscBlob = (OscBlob*)arguments[argumentIndex];
     *output = oscBlob->data;
@@ -95,16 +109,26 @@ bool OscMessage::getBool(int argumentIndex) {
     OscBool* oscBool = (OscBool*)arguments[argumentIndex];
     return oscBool->data;
 }
+char OscMessage::getChar(int argumentIndex) {
+    OscChar* oscChar = (OscChar*)arguments[argumentIndex];
+    return oscChar->data;
+}
+uint32_t OscMessage::getRgba(int argumentIndex) {
+    OscRgba* oscRgba = (OscRgba*)arguments[argumentIndex];
+    return oscRgba->data;
+}
 
 int OscMessage::getBuffer(char* outBuffer, int size) {
     const char* address = address_string;
     int len = size;
     char* buffer = outBuffer;
-    char format[64];
+    // arrays can make the format string arbitrarily long
+    std::string formatString;
+    formatString.reserve(arguments.size());
     for (int i = 0; i < arguments.size(); i++) {
-        format[i] = arguments[i]->getChar();
+        formatString.push_back(arguments[i]->getChar());
     }
-    format[arguments.size()] = 0;
+    const char* format = formatString.c_str();
 
     memset(buffer, 0, len); // clear the buffer
     uint32_t i = (uint32_t)strlen(address);
@@ -136,12 +160,7 @@ int OscMessage::getBuffer(char* outBuffer, int size) {
             char* b = (char*)oscBlob->data; // pointer to binary data
             *((uint32_t*)(buffer + i)) = htonl(n); i += 4;
             memcpy(buffer + i, b, n);
-            i += n;
-            while (i % 4 != 3) {
-                i++;
-                outBuffer[i] = 0;
-            }
-            i++;
+            i = (i + n + 3) & ~0x3; // blob data is padded to a multiple of 4, the buffer is already zeroed
             break;
         }
         case 'f': {
@@ -168,6 +187,20 @@ int OscMessage::getBuffer(char* outBuffer, int size) {
             i += 4;
             break;
         }
+        case 'c': {
+            OscChar* oscChar = (OscChar*)arguments[j];
+            if (i + 4 > len) return -3;
+            *((uint32_t*)(buffer + i)) = htonl((uint32_t)oscChar->data);
+            i += 4;
+            break;
+        }
+        case 'r': {
+            OscRgba* oscRgba = (OscRgba*)arguments[j];
+            if (i + 4 > len) return -3;
+            *((uint32_t*)(buffer + i)) = htonl(oscRgba->data);
+            i += 4;
+            break;
+        }
         case 'm': {
             OscMidi* oscMidi = (OscMidi*)arguments[j];
             if (i + 4 > len) return -3;
@@ -178,7 +211,13 @@ int OscMessage::getBuffer(char* outBuffer, int size) {
             i += 4;
             break;
         }
-        case 't':
+        case 't': {
+            OscTimetag* oscTimetag = (OscTimetag*)arguments[j];
+            if (i + 8 > len) return -3;
+            *((uint64_t*)(buffer + i)) = htonll(oscTimetag->data);
+            i += 8;
+            break;
+        }
         case 'h': {
             OscInt64* oscInt64 = (OscInt64*)arguments[j];
             if (i + 8 > len) return -3;
@@ -205,6 +244,8 @@ int OscMessage::getBuffer(char* outBuffer, int size) {
         case 'F': // false
         case 'N': // nil
         case 'I': // infinitum
+        case '[': // array start
+        case ']': // array end
             break;
         default: return -4; // unknown type
         }
@@ -219,13 +260,13 @@ namespace OscPacket {
 
     std::vector<std::shared_ptr<OscMessage>> getOscMessages(char* inBuffer, size_t size) {
         std::vector<std::shared_ptr<OscMessage>> output;
-        if (tosc_isBundle(inBuffer)) {
+        if (size >= 16 && tosc_isBundle(inBuffer)) {
             tosc_bundle bundle;
             tosc_parseBundle(&bundle, inBuffer, size);
             tosc_message message;
             uint64_t timetag = tosc_getTimetag(&bundle);
             while (tosc_getNextMessage(&bundle, &message)) {
-                output.push_back(std::make_shared<OscMessage>(message.buffer, message.len));
+                output.push_back(std::make_shared<OscMessage>(message.buffer, message.len, timetag));
             }
         }
         else {
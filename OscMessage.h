@@ -1,6 +1,7 @@
 #pragma once
 
 #include "tinyosc.h"
+#include "OscAddressTable.h"
 #include <vector>
 #include <memory>
 #include <string.h>
@@ -17,6 +18,10 @@ public:
 		MIDI,
 		TIMETAG,
 		BOOL,
+		CHAR,
+		RGBA,
+		ARRAY_BEGIN,
+		ARRAY_END,
 		UNKNOWN
 	};
 	Type type = Type::UNKNOWN;
@@ -29,7 +34,7 @@ public:
 	OscBlob(const char* d, int s) {
 		data = new char[s];
 		size = s;
-		memcpy(data, d, s);
+		if (s > 0) memcpy(data, d, s);
 		type = Type::BLOB;
 	}
 	~OscBlob() {
@@ -71,7 +76,11 @@ public:
 class OscString : public OscArgument {
 public:
 	OscString(const char* d) {
-		strcpy(data, d);
+		// strings too long to store are truncated
+		size_t n = 0;
+		while (d != nullptr && n < sizeof(data) - 1 && d[n] != '\0') n++;
+		if (n > 0) memcpy(data, d, n);
+		data[n] = '\0';
 		type = Type::STRING;
 	}
 	virtual char getChar() { return 's'; }
@@ -81,6 +90,8 @@ public:
 class OscMidi : public OscArgument {
 public:
 	OscMidi(unsigned char* d) {
+		static unsigned char none[4] = {0, 0, 0, 0};
+		if (d == nullptr) d = none;
 		portId = d[0];
 		statusByte = d[1];
 		data1 = d[2];
@@ -111,12 +122,35 @@ public:
 
 
 
+class OscChar : public OscArgument {
+public:
+	OscChar(char d) : data(d) { type = Type::CHAR; }
+	virtual char getChar() { return 'c'; }
+	char data;
+};
+
+class OscRgba : public OscArgument {
+public:
+	OscRgba(uint32_t d) : data(d) { type = Type::RGBA; }
+	virtual char getChar() { return 'r'; }
+	uint32_t data;
+};
+
+class OscArrayMarker : public OscArgument {
+public:
+	OscArrayMarker(bool begin) { type = begin ? Type::ARRAY_BEGIN : Type::ARRAY_END; }
+	virtual char getChar() { return type == Type::ARRAY_BEGIN ? '[' : ']'; }
+};
+
+
+
 class OscMessage {
 public:
 
-	OscMessage(char* inputBuffer, size_t size);
+	// packetTimetag is the timetag of the bundle the message came in, 0 if none
+	OscMessage(char* inputBuffer, size_t size, uint64_t packetTimetag = 0);
 	OscMessage(const char* address) {
-		strcpy(address_string, address);
+		setAddress(address, tosc_hashAddress(address));
 	}
 	~OscMessage() {
 		for (auto argument : arguments) delete argument;
@@ -131,6 +165,10 @@ public:
 	void addMidi(char port, char statusByte, char data1, char data2) { arguments.push_back(new OscMidi(port, statusByte, data1, data2)); }
 	void addTimetag(uint64_t data) { arguments.push_back(new OscTimetag(data)); }
 	void addBool(bool data) { arguments.push_back(new OscBool(data)); }
+	void addChar(char data) { arguments.push_back(new OscChar(data)); }
+	void addRgba(uint32_t data) { arguments.push_back(new OscRgba(data)); }
+	void beginArray() { arguments.push_back(new OscArrayMarker(true)); }
+	void endArray() { arguments.push_back(new OscArrayMarker(false)); }
 
 	bool isBlob(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::BLOB)		return true; else return false; }
 	bool isFloat(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::FLOAT)	return true; else return false; }
@@ -141,6 +179,12 @@ public:
 	bool isMidi(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::MIDI)		return true; else return false; }
 	bool isTimetag(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::TIMETAG)	return true; else return false; }
 	bool isBool(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::BOOL)		return true; else return false; }
+	bool isChar(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::CHAR)		return true; else return false; }
+	bool isRgba(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::RGBA)		return true; else return false; }
+	bool isArrayBegin(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::ARRAY_BEGIN)	return true; else return false; }
+	bool isArrayEnd(int argumentIndex) { if (argumentIndex < arguments.size() && arguments[argumentIndex]->type == OscArgument::Type::ARRAY_END)	return true; else return false; }
+
+	int getArgumentCount() { return (int)arguments.size(); }
 
 	int getBlob(int argumentIndex, char** output);
 	float getFloat(int argumentIndex);
@@ -151,18 +195,30 @@ public:
 	void getMidi(int argumentIndex, char* portInfo, char* statusByte, char* data1, char* data2);
 	uint64_t getTimetag(int argumentIndex);
 	bool getBool(int argumentIndex);
+	char getChar(int argumentIndex);
+	uint32_t getRgba(int argumentIndex);
 
 
 	bool matchesAddress(const char* address) { return strcmp(address, address_string) == 0; }
+	bool matchesAddress(uint32_t addressId) { return addressId != OscAddressTable::INVALID_ID && addressId == address_id; }
 	const char* getAddress() { return address_string; }
+	uint32_t getAddressId() { return address_id; }
 	uint64_t getPacketTimetag() { return timetag; }
 
+	// gives the address an id, so that messages to it can be matched by getAddressId().
+	// Received messages carry the id of registered addresses only, others get INVALID_ID.
+	// Returns INVALID_ID if the address is too long or the global table is full
+	static uint32_t registerAddress(const char* address) { return OscAddressTable::global().intern(address); }
+
 	int getBuffer(char* outBuffer, int size);
 
 private:
 
+	void setAddress(const char* address, uint32_t hash);
+
 	uint64_t timetag = 0;
-	char address_string[128];
+	char address_string[OscAddressTable::MAX_ADDRESS_LENGTH] = {0};
+	uint32_t address_id = OscAddressTable::INVALID_ID;
 	std::vector<OscArgument*> arguments;
 };
 
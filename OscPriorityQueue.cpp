@@ -0,0 +1,127 @@
+#include "OscPriorityQueue.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+OscPriorityQueue::OscPriorityQueue(size_t capacity) : totalCapacity(capacity) {}
+
+int OscPriorityQueue::addClass(size_t capacity, OverflowPolicy policy, bool coalesce) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto priorityClass = std::make_unique<PriorityClass>();
+    priorityClass->capacity = capacity;
+    priorityClass->policy = policy;
+    priorityClass->coalesce = coalesce;
+    classes.push_back(std::move(priorityClass));
+    return (int)classes.size() - 1;
+}
+
+void OscPriorityQueue::addPrefix(const char* prefix, int classIndex) {
+    std::lock_guard<std::mutex> lock(mutex);
+    prefixes.push_back({ prefix, classIndex });
+    std::stable_sort(prefixes.begin(), prefixes.end(), [](const Prefix& a, const Prefix& b) { return a.prefix.size() > b.prefix.size(); });
+}
+
+int OscPriorityQueue::getClass(const char* address) {
+    for (auto& p : prefixes) {
+        if (strncmp(address, p.prefix.c_str(), p.prefix.size()) == 0) return p.classIndex;
+    }
+    return (int)classes.size() - 1;
+}
+
+void OscPriorityQueue::dropFront(PriorityClass& priorityClass) {
+    auto& front = priorityClass.queue.front();
+    auto entry = priorityClass.byAddress.find(front->getAddressId());
+    if (entry != priorityClass.byAddress.end() && entry->second == &front) priorityClass.byAddress.erase(entry);
+    priorityClass.queue.pop_front();
+    priorityClass.stats.dropped++;
+    totalSize--;
+}
+
+bool OscPriorityQueue::push(std::shared_ptr<OscMessage> message) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (classes.empty()) return false;
+        PriorityClass& priorityClass = *classes[getClass(message->getAddress())];
+
+        uint32_t addressId = message->getAddressId();
+        if (priorityClass.coalesce && addressId != OscAddressTable::INVALID_ID) {
+            auto entry = priorityClass.byAddress.find(addressId);
+            if (entry != priorityClass.byAddress.end()) {
+                // keep the queue position of the older message, only its value changes
+                *entry->second = std::move(message);
+                priorityClass.stats.coalesced++;
+                return true;
+            }
+        }
+
+        // evicting only helps if the message then fits in its own class, otherwise
+        // it would be dropped as well and the push would cost two messages
+        if (totalSize >= totalCapacity && evictLowerPriority && priorityClass.queue.size() < priorityClass.capacity) {
+            for (size_t i = classes.size(); i-- > 0 && classes[i].get() != &priorityClass;) {
+                if (!classes[i]->queue.empty()) {
+                    dropFront(*classes[i]);
+                    break;
+                }
+            }
+        }
+
+        if (priorityClass.queue.size() >= priorityClass.capacity || totalSize >= totalCapacity) {
+            if (priorityClass.policy == OverflowPolicy::DROP_NEWEST || priorityClass.queue.empty()) {
+                priorityClass.stats.dropped++;
+                return false;
+            }
+            dropFront(priorityClass);
+        }
+
+        priorityClass.queue.push_back(std::move(message));
+        if (priorityClass.coalesce && addressId != OscAddressTable::INVALID_ID) {
+            priorityClass.byAddress[addressId] = &priorityClass.queue.back();
+        }
+        priorityClass.stats.enqueued++;
+        totalSize++;
+    }
+    available.notify_one();
+    return true;
+}
+
+int OscPriorityQueue::push(char* buffer, size_t size) {
+    int dropped = 0;
+    for (auto& message : OscPacket::getOscMessages(buffer, size)) {
+        if (!push(message)) dropped++;
+    }
+    return dropped;
+}
+
+std::shared_ptr<OscMessage> OscPriorityQueue::popLocked() {
+    for (auto& priorityClass : classes) {
+        if (priorityClass->queue.empty()) continue;
+        auto& front = priorityClass->queue.front();
+        auto entry = priorityClass->byAddress.find(front->getAddressId());
+        if (entry != priorityClass->byAddress.end() && entry->second == &front) priorityClass->byAddress.erase(entry);
+        std::shared_ptr<OscMessage> message = std::move(front);
+        priorityClass->queue.pop_front();
+        priorityClass->stats.dispatched++;
+        totalSize--;
+        return message;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<OscMessage> OscPriorityQueue::pop(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait_for(lock, timeout, [this] { return totalSize > 0; });
+    return popLocked();
+}
+
+std::shared_ptr<OscMessage> OscPriorityQueue::tryPop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return popLocked();
+}
+
+OscPriorityQueue::ClassStats OscPriorityQueue::getStats(int classIndex) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ClassStats stats = classes[classIndex]->stats;
+    stats.size = classes[classIndex]->queue.size();
+    return stats;
+}
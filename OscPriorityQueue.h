@@ -0,0 +1,94 @@
+#pragma once
+
+#include "OscMessage.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bounded queues between the receive thread and the dispatch thread, one per priority class.
+// Messages are assigned to a class by address prefix and dispatched highest priority first.
+// When the queues are full, messages are dropped according to the policy of their class,
+// so that critical traffic keeps a bounded latency under overload.
+class OscPriorityQueue {
+public:
+
+	enum class OverflowPolicy {
+		DROP_NEWEST, // drop the incoming message
+		DROP_OLDEST // drop the oldest message of the class
+	};
+
+	struct ClassStats {
+		uint64_t enqueued = 0; // messages accepted
+		uint64_t dispatched = 0; // messages handed to the dispatch thread
+		uint64_t dropped = 0; // messages lost to overload
+		uint64_t coalesced = 0; // messages replaced by a newer one for the same address
+		size_t size = 0; // messages currently queued
+	};
+
+	// totalCapacity bounds the number of messages queued over all classes
+	OscPriorityQueue(size_t totalCapacity);
+
+	// adds a class, classes added first have the highest priority. Returns the class index.
+	// With coalesce, a message replaces the queued message with the same address in place.
+	// Only addresses with an id (see OscMessage::registerAddress) are coalesced
+	int addClass(size_t capacity, OverflowPolicy policy, bool coalesce = false);
+
+	// messages whose address starts with prefix go to the class, the longest prefix wins.
+	// Messages matching no prefix go to the last class
+	void addPrefix(const char* prefix, int classIndex);
+
+	// when the total capacity is exhausted and the class of the incoming message has room,
+	// evict the oldest message of the lowest priority class below it. Otherwise the
+	// overflow policy of the incoming class applies
+	void setEvictLowerPriority(bool evict) { evictLowerPriority = evict; }
+
+	// queues a message. Returns false if it was dropped
+	bool push(std::shared_ptr<OscMessage> message);
+
+	// queues all messages of a packet. Returns the number of messages dropped
+	int push(char* buffer, size_t size);
+
+	// returns the highest priority message, waiting up to timeout. Returns nullptr on timeout
+	std::shared_ptr<OscMessage> pop(std::chrono::milliseconds timeout);
+
+	// returns the highest priority message or nullptr, without waiting
+	std::shared_ptr<OscMessage> tryPop();
+
+	int getClassCount() { return (int)classes.size(); }
+	int getClass(const char* address);
+	ClassStats getStats(int classIndex);
+
+private:
+
+	struct PriorityClass {
+		size_t capacity;
+		OverflowPolicy policy;
+		bool coalesce;
+		std::deque<std::shared_ptr<OscMessage>> queue;
+		// queued messages by address id, deque elements keep their address while at the front or back changes
+		std::unordered_map<uint32_t, std::shared_ptr<OscMessage>*> byAddress;
+		ClassStats stats;
+	};
+
+	struct Prefix {
+		std::string prefix;
+		int classIndex;
+	};
+
+	void dropFront(PriorityClass& priorityClass);
+	std::shared_ptr<OscMessage> popLocked();
+
+	std::vector<std::unique_ptr<PriorityClass>> classes;
+	std::vector<Prefix> prefixes; // sorted from longest to shortest
+	size_t totalCapacity;
+	size_t totalSize = 0;
+	bool evictLowerPriority = true;
+
+	std::mutex mutex;
+	std::condition_variable available;
+};
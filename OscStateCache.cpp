@@ -0,0 +1,106 @@
+#include "OscStateCache.h"
+
+#include <algorithm>
+#include <string.h>
+
+
+OscStateCache::OscStateCache(uint32_t maxAddresses) : addresses(maxAddresses), slots(new Slot[maxAddresses]), currentEpoch(0) {
+    for (uint32_t i = 0; i < maxAddresses; i++) {
+        slots[i].sequence.store(0, std::memory_order_relaxed);
+        slots[i].length.store(0, std::memory_order_relaxed);
+        slots[i].epoch.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool OscStateCache::update(tosc_message* message) {
+    uint32_t length = tosc_getLength(message);
+    if (length > SLOT_SIZE) return false;
+    uint32_t id = addresses.intern(tosc_getAddress(message), tosc_getAddressHash(message));
+    if (id == OscAddressTable::INVALID_ID) return false;
+    Slot& slot = slots[id];
+
+    // take the slot, writers of the same address serialise here
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    while ((sequence & 1) || !slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        sequence = slot.sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const char* buffer = message->buffer;
+    for (uint32_t i = 0; i * 8 < length; i++) {
+        uint64_t word = 0;
+        memcpy(&word, buffer + i * 8, std::min<uint32_t>(8, length - i * 8));
+        slot.data[i].store(word, std::memory_order_relaxed);
+    }
+    slot.length.store(length, std::memory_order_relaxed);
+    slot.epoch.store(currentEpoch.fetch_add(1, std::memory_order_acq_rel) + 1, std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    return true;
+}
+
+int OscStateCache::update(char* buffer, size_t size) {
+    int stored = 0;
+    if (size >= 16 && tosc_isBundle(buffer)) {
+        tosc_bundle bundle;
+        tosc_parseBundle(&bundle, buffer, size);
+        tosc_message message;
+        while (tosc_getNextMessage(&bundle, &message)) {
+            if (update(&message)) stored++;
+        }
+    }
+    else {
+        tosc_message message;
+        if (0 == tosc_parseMessage(&message, buffer, size) && update(&message)) stored++;
+    }
+    return stored;
+}
+
+uint32_t OscStateCache::readSlot(Slot& slot, char* buffer, uint64_t* epoch) {
+    while (true) {
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) continue; // a writer is in the slot
+        uint32_t length = slot.length.load(std::memory_order_relaxed);
+        uint64_t slotEpoch = slot.epoch.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i * 8 < length; i++) {
+            uint64_t word = slot.data[i].load(std::memory_order_relaxed);
+            memcpy(buffer + i * 8, &word, std::min<uint32_t>(8, length - i * 8));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) continue;
+        if (epoch != nullptr) *epoch = slotEpoch;
+        return length;
+    }
+}
+
+bool OscStateCache::read(const char* address, char* buffer, tosc_message* message, uint64_t* epoch) {
+    return read(addresses.find(address), buffer, message, epoch);
+}
+
+bool OscStateCache::read(uint32_t addressId, char* buffer, tosc_message* message, uint64_t* epoch) {
+    if (addressId >= addresses.size()) return false;
+    uint32_t length = readSlot(slots[addressId], buffer, epoch);
+    return length > 0 && 0 == tosc_parseMessage(message, buffer, length);
+}
+
+uint64_t OscStateCache::getChangedSince(uint64_t epoch, const Visitor& visitor) {
+    // updates which land during the scan are reported again on the next call, never missed
+    uint64_t latest = currentEpoch.load(std::memory_order_acquire);
+    char buffer[SLOT_SIZE];
+    uint32_t count = addresses.size();
+    for (uint32_t id = 0; id < count; id++) {
+        Slot& slot = slots[id];
+        // a writer takes its epoch before it stores it in the slot. Waiting until it
+        // has left the slot makes every epoch up to latest visible here
+        uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        while (sequence & 1) sequence = slot.sequence.load(std::memory_order_acquire);
+        if (slot.epoch.load(std::memory_order_relaxed) <= epoch) continue;
+        uint64_t slotEpoch;
+        uint32_t length = readSlot(slot, buffer, &slotEpoch);
+        tosc_message message;
+        if (length > 0 && slotEpoch > epoch && 0 == tosc_parseMessage(&message, buffer, length)) {
+            visitor(id, slotEpoch, &message);
+        }
+    }
+    return latest;
+}
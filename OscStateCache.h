@@ -0,0 +1,63 @@
+#pragma once
+
+#include "tinyosc.h"
+#include "OscAddressTable.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Keeps the latest message received for each address, so that threads which only
+// need "the current value of /x" don't have to subscribe and parse on their own.
+// Messages are stored inline in fixed-size slots. Readers never take a lock,
+// each slot is protected by a seqlock and readers retry if they raced a writer.
+class OscStateCache {
+public:
+
+	static const int SLOT_SIZE = 256; // the longest message which can be stored
+
+	typedef std::function<void(uint32_t addressId, uint64_t epoch, tosc_message* message)> Visitor;
+
+	OscStateCache(uint32_t maxAddresses);
+
+	OscStateCache(const OscStateCache&) = delete;
+	OscStateCache& operator=(const OscStateCache&) = delete;
+
+	// stores a copy of the message as the current value of its address.
+	// Returns false if the message is too long or the cache holds too many addresses
+	bool update(tosc_message* message);
+
+	// updates the cache with all messages of a packet. Returns the number of messages stored
+	int update(char* buffer, size_t size);
+
+	// copies the current value of an address into buffer (at least SLOT_SIZE bytes) and parses it into message.
+	// Returns false if nothing was received for the address
+	bool read(const char* address, char* buffer, tosc_message* message, uint64_t* epoch = nullptr);
+	bool read(uint32_t addressId, char* buffer, tosc_message* message, uint64_t* epoch = nullptr);
+
+	// calls visitor with every value updated after the given epoch.
+	// Returns the epoch to pass on the next call to only get later changes
+	uint64_t getChangedSince(uint64_t epoch, const Visitor& visitor);
+
+	// the epoch of the most recent update
+	uint64_t getEpoch() { return currentEpoch.load(std::memory_order_acquire); }
+
+	uint32_t getAddressId(const char* address) { return addresses.find(address); }
+
+private:
+
+	static const int SLOT_WORDS = SLOT_SIZE / 8;
+
+	struct Slot {
+		std::atomic<uint32_t> sequence; // odd while a writer is changing the slot
+		std::atomic<uint32_t> length;
+		std::atomic<uint64_t> epoch; // 0 if the slot was never written
+		std::atomic<uint64_t> data[SLOT_WORDS];
+	};
+
+	// copies a consistent snapshot of a slot. Returns its length, 0 if it is empty
+	uint32_t readSlot(Slot& slot, char* buffer, uint64_t* epoch);
+
+	OscAddressTable addresses; // address ids are the slot indices
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<uint64_t> currentEpoch;
+};
@@ -0,0 +1,106 @@
+// Runs coroutines on an OscEventLoop over loopback: one sends timed bundles,
+// one receives them, a second receiver on the same socket must be turned
+// away, and a socket on a port in use must report the error.
+// Exits with 1 if a check fails.
+//
+//   OscAsyncTest [messages]
+
+#include "../OscAsync.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+namespace {
+
+    int numFailures = 0;
+
+    void check(bool ok, const char* what) {
+        if (!ok) {
+            printf("FAILED: %s\n", what);
+            numFailures++;
+        }
+    }
+
+    // the wall clock as an OSC timetag, offset by the given number of milliseconds
+    uint64_t getTimetag(int offsetMs) {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec + (uint64_t)offsetMs * 1000000ULL;
+        uint64_t seconds = ns / 1000000000ULL + 2208988800ULL;
+        uint64_t fraction = ((ns % 1000000000ULL) << 32) / 1000000000ULL;
+        return (seconds << 32) | fraction;
+    }
+
+    OscTask sender(OscEventLoop& loop, OscSocket& socket, sockaddr_in destination, int count) {
+        uint64_t storage[16]; // tinyosc writes bundles with aligned stores
+        char* buffer = (char*)storage;
+        for (int i = 0; i < count; i++) {
+            // every tenth bundle is due a little later, and waited for before it is sent
+            uint64_t timetag = (i % 10 == 0) ? getTimetag(5) : TINYOSC_TIMETAG_IMMEDIATELY;
+            tosc_bundle bundle;
+            tosc_writeBundle(&bundle, timetag, buffer, sizeof(storage));
+            tosc_writeNextMessage(&bundle, "/count", "i", i);
+            co_await loop.waitUntil(timetag);
+            check(timetag == TINYOSC_TIMETAG_IMMEDIATELY || getTimetag(0) >= timetag, "waitUntil() resumed early");
+            int sent = co_await socket.send(buffer, (int)tosc_getBundleLength(&bundle), destination);
+            check(sent == (int)tosc_getBundleLength(&bundle), "send() did not send the whole bundle");
+        }
+    }
+
+    OscTask receiver(OscEventLoop& loop, OscSocket& socket, int count, int* received) {
+        int expected = 0;
+        while (*received < count) {
+            const std::vector<OscMessageView>& views = co_await socket.receive();
+            for (auto& view : views) {
+                tosc_message message = view.message;
+                check(strcmp(tosc_getAddress(&message), "/count") == 0, "received the wrong address");
+                check(tosc_getNextInt32(&message) == expected++, "received the messages out of order");
+                (*received)++;
+            }
+        }
+        loop.stop();
+    }
+
+    // starts waiting after the receiver above, and must not take its place
+    OscTask intruder(OscSocket& socket, bool* turnedAway) {
+        const std::vector<OscMessageView>& views = co_await socket.receive();
+        *turnedAway = views.empty();
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+    int count = (argc > 1) ? atoi(argv[1]) : 1000;
+    if (count <= 0) count = 1000;
+
+    OscEventLoop loop;
+    check(loop.isOpen(), "the event loop could not be opened");
+    OscSocket in(loop);
+    OscSocket out(loop);
+    check(in.isOpen() && out.isOpen(), "the sockets could not be opened");
+
+    OscSocket taken(loop, in.getPort());
+    check(!taken.isOpen() && taken.getError() == EADDRINUSE, "a socket on a port in use did not report EADDRINUSE");
+
+    sockaddr_in destination = {};
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(in.getPort());
+    destination.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int received = 0;
+    bool turnedAway = false;
+    loop.spawn(receiver(loop, in, count, &received));
+    loop.spawn(intruder(in, &turnedAway));
+    loop.spawn(sender(loop, out, destination, count));
+    loop.run();
+
+    check(turnedAway, "a second receive() on the same socket was not turned away");
+    check(received == count, "not all messages were received");
+    printf("%d of %d messages received\n%s\n", received, count, (numFailures == 0) ? "OK" : "FAILED");
+    return (numFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+// Decodes bundles of increasing size with an increasing number of threads,
+// and reports messages per second and the speedup over one thread.
+//
+//   OscBundleDecoderBench [max threads] [repeats]
+
+#include "../OscBundleDecoder.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+    // a state dump with one message per parameter. Messages are appended one
+    // by one, as tosc_writeNextMessage clears the rest of the buffer each time
+    std::vector<char> makeBundle(int numMessages) {
+        std::vector<char> buffer(16);
+        tosc_bundle bundle;
+        tosc_writeBundle(&bundle, 1, buffer.data(), (int)buffer.size());
+        char address[32];
+        char message[64];
+        for (int i = 0; i < numMessages; i++) {
+            snprintf(address, sizeof(address), "/state/%d", i % 1000);
+            uint32_t len = tosc_writeMessage(message, sizeof(message), address, "ifs", i, 0.5f, "value");
+            uint32_t prefix = htonl(len);
+            buffer.insert(buffer.end(), (char*)&prefix, (char*)&prefix + 4);
+            buffer.insert(buffer.end(), message, message + len);
+        }
+        return buffer;
+    }
+
+    // the fastest of several runs, in seconds
+    double timeDecode(OscBundleDecoder& decoder, std::vector<char>& bundle, int repeats) {
+        double best = 1e9;
+        for (int r = 0; r < repeats; r++) {
+            auto start = std::chrono::steady_clock::now();
+            auto messages = decoder.decode(bundle.data(), bundle.size());
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::min(best, elapsed);
+        }
+        return best;
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+    int maxThreads = (argc > 1) ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    int repeats = (argc > 2) ? atoi(argv[2]) : 5;
+    if (maxThreads <= 0) maxThreads = 1;
+    if (repeats <= 0) repeats = 1;
+    printf("%u cores, up to %d threads, best of %d runs\n",
+        std::thread::hardware_concurrency(), maxThreads, repeats);
+
+    std::vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    printf("%10s %10s %8s %12s %14s %8s\n", "messages", "bytes", "threads", "ms", "messages/s", "speedup");
+    for (int numMessages : { 1000, 10000, 100000, 1000000 }) {
+        std::vector<char> bundle = makeBundle(numMessages);
+        double single = 0;
+        for (int threads : threadCounts) {
+            OscBundleDecoder decoder(threads);
+            double seconds = timeDecode(decoder, bundle, repeats);
+            if (threads == 1) single = seconds;
+            printf("%10d %10zu %8d %12.3f %14.0f %7.2fx\n", numMessages, bundle.size(), threads,
+                seconds * 1000, numMessages / seconds, single / seconds);
+        }
+    }
+    return 0;
+}
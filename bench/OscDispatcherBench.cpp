@@ -0,0 +1,110 @@
+// Dispatches from several threads while another thread keeps adding and
+// removing handlers, and reports lookups and updates per second.
+//
+//   OscDispatcherBench [dispatching threads] [seconds] [updates per second]
+
+#include "../OscDispatcher.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+    const int NUM_ADDRESSES = 1000; // always registered
+    const int NUM_CHURN = 100; // added and removed by the updating thread
+
+    std::vector<std::vector<char>> makeMessages() {
+        std::vector<std::vector<char>> messages;
+        char buffer[64];
+        for (int i = 0; i < NUM_ADDRESSES; i++) {
+            uint32_t len = tosc_writeMessage(buffer, sizeof(buffer), ("/mixer/" + std::to_string(i)).c_str(), "f", 0.5f);
+            messages.emplace_back(buffer, buffer + len);
+        }
+        return messages;
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+    int numThreads = (argc > 1) ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    double seconds = (argc > 2) ? atof(argv[2]) : 2.0;
+    int updateRate = (argc > 3) ? atoi(argv[3]) : 1000;
+    if (numThreads <= 0) numThreads = 1;
+    if (seconds <= 0) seconds = 2.0;
+
+    OscDispatcher dispatcher;
+    std::atomic<uint64_t> handled(0);
+    for (int i = 0; i < NUM_ADDRESSES; i++) {
+        dispatcher.add(("/mixer/" + std::to_string(i)).c_str(), [&handled](tosc_message*) {
+            handled.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    auto messages = makeMessages();
+
+    std::atomic<bool> stop(false);
+    std::vector<uint64_t> lookups(numThreads, 0);
+    std::vector<uint64_t> misses(numThreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t] {
+            std::vector<tosc_message> parsed(messages.size());
+            for (size_t i = 0; i < messages.size(); i++) {
+                tosc_parseMessage(&parsed[i], messages[i].data(), (int)messages[i].size());
+            }
+            uint64_t n = 0;
+            uint64_t missed = 0;
+            size_t next = (size_t)t * 7919;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 1000; i++) {
+                    next = (next + 7919) % parsed.size();
+                    if (!dispatcher.dispatch(&parsed[next])) missed++;
+                }
+                n += 1000;
+            }
+            lookups[t] = n;
+            misses[t] = missed;
+        });
+    }
+
+    // the churn addresses are never dispatched, each update still publishes a new table
+    uint64_t updates = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    auto interval = std::chrono::duration<double>(updateRate > 0 ? 1.0 / updateRate : seconds);
+    auto nextUpdate = start;
+    while (std::chrono::steady_clock::now() < end) {
+        if (updateRate > 0 && std::chrono::steady_clock::now() >= nextUpdate) {
+            std::string address = "/churn/" + std::to_string(updates % NUM_CHURN);
+            if ((updates / NUM_CHURN) % 2 == 0) dispatcher.add(address.c_str(), [](tosc_message*) {});
+            else dispatcher.remove(address.c_str());
+            updates++;
+            nextUpdate += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+        }
+        else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    stop.store(true);
+    for (auto& thread : threads) thread.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    uint64_t missed = 0;
+    for (int t = 0; t < numThreads; t++) {
+        total += lookups[t];
+        missed += misses[t];
+    }
+    printf("%d dispatching threads, %u cores, %.1f s\n", numThreads, std::thread::hardware_concurrency(), elapsed);
+    printf("lookups: %.0f/s, %.0f/s per thread, %.1f ns each\n", total / elapsed, total / elapsed / numThreads,
+        total > 0 ? elapsed * 1e9 * numThreads / total : 0.0);
+    printf("updates: %.0f/s (%llu)\n", updates / elapsed, (unsigned long long)updates);
+    if (missed > 0 || handled.load() != total) {
+        printf("FAILED: %llu lookups missed a registered handler\n", (unsigned long long)(total - handled.load()));
+        return 1;
+    }
+    return 0;
+}
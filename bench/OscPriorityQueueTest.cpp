@@ -0,0 +1,161 @@
+// Checks the overflow policies of OscPriorityQueue, then overloads it from a
+// receive thread and reports how long critical and bulk messages waited to be
+// dispatched, against a single FIFO queue of the same size.
+// Exits with 1 if a check fails.
+//
+//   OscPriorityQueueTest [seconds]
+
+#include "../OscPriorityQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+    int numFailures = 0;
+
+    void check(bool ok, const char* what) {
+        if (!ok) {
+            printf("FAILED: %s\n", what);
+            numFailures++;
+        }
+    }
+
+    int64_t getNanoseconds() {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    }
+
+    std::shared_ptr<OscMessage> makeMessage(const char* address, int64_t value) {
+        char buffer[64];
+        uint32_t len = tosc_writeMessage(buffer, sizeof(buffer), address, "h", (long long)value);
+        return std::make_shared<OscMessage>(buffer, len);
+    }
+
+    // fills the bulk class and the total, then pushes critical messages until their
+    // own class is full. Each push must cost at most one message
+    void checkEviction(OscPriorityQueue::OverflowPolicy policy, const char* name) {
+        char what[128];
+        OscPriorityQueue queue(4);
+        int critical = queue.addClass(2, policy);
+        int bulk = queue.addClass(4, OscPriorityQueue::OverflowPolicy::DROP_OLDEST);
+        queue.addPrefix("/transport", critical);
+        for (int i = 0; i < 4; i++) queue.push(makeMessage("/bulk", i));
+
+        // the total is full, each of these evicts a bulk message to make room
+        for (int i = 0; i < 2; i++) {
+            snprintf(what, sizeof(what), "%s: a critical message was not admitted by eviction", name);
+            check(queue.push(makeMessage("/transport/play", i)), what);
+        }
+        snprintf(what, sizeof(what), "%s: eviction dropped %llu bulk messages instead of 2", name,
+            (unsigned long long)queue.getStats(bulk).dropped);
+        check(queue.getStats(bulk).dropped == 2, what);
+
+        // the critical class is full, so eviction would not admit the message
+        bool admitted = queue.push(makeMessage("/transport/play", 2));
+        auto criticalStats = queue.getStats(critical);
+        auto bulkStats = queue.getStats(bulk);
+        snprintf(what, sizeof(what), "%s: a push into a full class evicted a bulk message", name);
+        check(bulkStats.dropped == 2 && bulkStats.size == 2, what);
+        snprintf(what, sizeof(what), "%s: a push into a full class dropped %llu critical messages", name,
+            (unsigned long long)criticalStats.dropped);
+        check(criticalStats.dropped == 1 && criticalStats.size == 2, what);
+        if (policy == OscPriorityQueue::OverflowPolicy::DROP_NEWEST) {
+            snprintf(what, sizeof(what), "%s: the newest message was admitted", name);
+            check(!admitted, what);
+        }
+        else {
+            snprintf(what, sizeof(what), "%s: the newest message was not admitted", name);
+            check(admitted, what);
+            auto first = queue.tryPop();
+            snprintf(what, sizeof(what), "%s: the oldest message was not the one dropped", name);
+            check(first != nullptr && first->getInt64(0) == 1, what);
+        }
+    }
+
+    struct Latencies {
+        std::vector<int64_t> critical;
+        std::vector<int64_t> bulk;
+    };
+
+    int64_t percentile(std::vector<int64_t>& v, int p) {
+        if (v.empty()) return 0;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, v.size() * p / 100)];
+    }
+
+    // a receive thread sends bursts of bulk messages with a critical one among them,
+    // faster than the dispatch thread, which spends workNs on each message, can keep up
+    Latencies overload(OscPriorityQueue& queue, double seconds, int64_t workNs) {
+        Latencies latencies;
+        std::atomic<bool> stop(false);
+        std::thread receiver([&] {
+            while (!stop.load()) {
+                for (int i = 0; i < 50; i++) queue.push(makeMessage("/meter/level", getNanoseconds()));
+                queue.push(makeMessage("/transport/play", getNanoseconds()));
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+        int64_t end = getNanoseconds() + (int64_t)(seconds * 1e9);
+        while (getNanoseconds() < end) {
+            auto message = queue.pop(std::chrono::milliseconds(10));
+            if (message == nullptr) continue;
+            int64_t now = getNanoseconds();
+            bool critical = strncmp(message->getAddress(), "/transport", 10) == 0;
+            (critical ? latencies.critical : latencies.bulk).push_back(now - message->getInt64(0));
+            while (getNanoseconds() - now < workNs) {}
+        }
+        stop.store(true);
+        receiver.join();
+        return latencies;
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    if (seconds <= 0) seconds = 2.0;
+
+    checkEviction(OscPriorityQueue::OverflowPolicy::DROP_NEWEST, "drop newest");
+    checkEviction(OscPriorityQueue::OverflowPolicy::DROP_OLDEST, "drop oldest");
+
+    const int64_t workNs = 20000;
+    OscPriorityQueue prioritised(256);
+    int critical = prioritised.addClass(16, OscPriorityQueue::OverflowPolicy::DROP_OLDEST);
+    int bulk = prioritised.addClass(256, OscPriorityQueue::OverflowPolicy::DROP_OLDEST);
+    prioritised.addPrefix("/transport", critical);
+    Latencies withClasses = overload(prioritised, seconds / 2, workNs);
+
+    OscPriorityQueue fifo(256);
+    fifo.addClass(256, OscPriorityQueue::OverflowPolicy::DROP_OLDEST);
+    Latencies withFifo = overload(fifo, seconds / 2, workNs);
+
+    auto criticalStats = prioritised.getStats(critical);
+    auto bulkStats = prioritised.getStats(bulk);
+    printf("overload with %lld us of work per message, %.1f s each:\n", (long long)(workNs / 1000), seconds / 2);
+    printf("  classes, critical: %zu dispatched, %llu dropped, p50 %lld us, p99 %lld us, max %lld us\n",
+        withClasses.critical.size(), (unsigned long long)criticalStats.dropped,
+        (long long)percentile(withClasses.critical, 50) / 1000, (long long)percentile(withClasses.critical, 99) / 1000,
+        (long long)percentile(withClasses.critical, 100) / 1000);
+    printf("  classes, bulk:     %zu dispatched, %llu dropped, p50 %lld us, p99 %lld us\n",
+        withClasses.bulk.size(), (unsigned long long)bulkStats.dropped,
+        (long long)percentile(withClasses.bulk, 50) / 1000, (long long)percentile(withClasses.bulk, 99) / 1000);
+    printf("  fifo, critical:    %zu dispatched, p50 %lld us, p99 %lld us, max %lld us\n",
+        withFifo.critical.size(), (long long)percentile(withFifo.critical, 50) / 1000,
+        (long long)percentile(withFifo.critical, 99) / 1000, (long long)percentile(withFifo.critical, 100) / 1000);
+
+    check(criticalStats.dropped == 0, "critical messages were dropped under overload");
+    check(bulkStats.dropped > 0, "the bulk class was not overloaded");
+    // behind at most a few critical messages and the one being dispatched,
+    // rather than behind a full queue of bulk messages
+    check(percentile(withClasses.critical, 50) < percentile(withFifo.critical, 50) / 4,
+        "critical messages did not overtake the bulk messages");
+    printf("%s\n", (numFailures == 0) ? "OK" : "FAILED");
+    return (numFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+#!/bin/bash
+# Builds the benchmarks and self-tests. Most of them use Linux system calls.
+
+cd "$(dirname "$0")"
+if type "clang" > /dev/null 2>&1; then
+  CC=clang
+  CXX=clang++
+else
+  CC="gcc -std=gnu99"
+  CXX=g++
+fi
+CFLAGS="-O2 -g"
+
+$CC $CFLAGS bundler_bench.c ../tinyosc.c ../tinyosc_bundler.c -o bundler_bench
+$CC $CFLAGS fanout_bench.c ../tinyosc.c ../tinyosc_fanout.c -o fanout_bench
+$CC $CFLAGS -c ../tinyosc.c -o tinyosc.o
+$CXX -std=c++17 $CFLAGS OscBundleDecoderBench.cpp ../OscBundleDecoder.cpp ../OscMessage.cpp ../OscAddressTable.cpp tinyosc.o -lpthread -o OscBundleDecoderBench
+$CXX -std=c++17 $CFLAGS OscDispatcherBench.cpp ../OscDispatcher.cpp tinyosc.o -lpthread -o OscDispatcherBench
+$CXX -std=c++20 $CFLAGS OscAsyncTest.cpp ../OscAsync.cpp tinyosc.o -o OscAsyncTest
+$CXX -std=c++17 $CFLAGS OscPriorityQueueTest.cpp ../OscPriorityQueue.cpp ../OscMessage.cpp ../OscAddressTable.cpp tinyosc.o -lpthread -o OscPriorityQueueTest
+rm -f tinyosc.o
+$CC $CFLAGS shm_bench.c ../tinyosc.c ../tinyosc_shm.c -lrt -o shm_bench
+$CC $CFLAGS latency_selftest.c ../tinyosc.c ../tinyosc_latency.c -o latency_selftest
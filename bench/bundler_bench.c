@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * Sends the same messages over loopback UDP once as one datagram each and
+ * once through tosc_bundler, and reports messages and packets per second
+ * (from the CPU time spent encoding and sending) and bytes per packet.
+ *
+ *   bundler_bench [messages] [mtu]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../tinyosc.h"
+#include "../tinyosc_bundler.h"
+
+// the receiver is drained every few datagrams, so that its buffer never fills
+#define DRAIN_INTERVAL 16
+
+typedef struct sender {
+  int fd; // connected to the receiver
+  int receiver;
+  uint64_t numPackets; // datagrams sent
+  uint64_t numBytes; // bytes sent
+  uint64_t numReceived; // messages received
+  uint64_t drainCpu; // nanoseconds spent receiving, not counted as sending
+} sender;
+
+static uint64_t getCpuNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// counts the messages received, bundles are unpacked
+static void drain(sender *s) {
+  const uint64_t start = getCpuNanoseconds();
+  char buffer[65536];
+  int len;
+  while ((len = (int) recv(s->receiver, buffer, sizeof(buffer), 0)) > 0) {
+    if (tosc_isBundle(buffer)) {
+      tosc_bundle bundle;
+      tosc_message osc;
+      tosc_parseBundle(&bundle, buffer, len);
+      while (tosc_getNextMessage(&bundle, &osc)) s->numReceived++;
+    } else {
+      s->numReceived++;
+    }
+  }
+  s->drainCpu += getCpuNanoseconds() - start;
+}
+
+static void sendPacket(sender *s, const char *buffer, const uint32_t len) {
+  send(s->fd, buffer, len, 0);
+  s->numPackets++;
+  s->numBytes += len;
+  if (s->numPackets % DRAIN_INTERVAL == 0) drain(s);
+}
+
+static void flushBundle(void *userData, const char *buffer, uint32_t len,
+    uint64_t timetag) {
+  (void) timetag;
+  sendPacket((sender *) userData, buffer, len);
+}
+
+static void report(const char *name, sender *s, const int numMessages,
+    const uint64_t cpu) {
+  drain(s);
+  printf("%-10s %.0f msg/s, %.0f pkt/s, %.1f B/pkt, %.1f msg/pkt, %llu of %d received\n",
+      name, numMessages * 1e9 / cpu, s->numPackets * 1e9 / cpu,
+      (double) s->numBytes / s->numPackets, (double) numMessages / s->numPackets,
+      (unsigned long long) s->numReceived, numMessages);
+}
+
+static int openSender(sender *s) {
+  struct sockaddr_in sin;
+  socklen_t sinLen = sizeof(sin);
+  memset(s, 0, sizeof(sender));
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  s->receiver = socket(AF_INET, SOCK_DGRAM, 0);
+  s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+  fcntl(s->receiver, F_SETFL, O_NONBLOCK);
+  if (bind(s->receiver, (struct sockaddr *) &sin, sizeof(sin)) != 0 ||
+      getsockname(s->receiver, (struct sockaddr *) &sin, &sinLen) != 0 ||
+      connect(s->fd, (struct sockaddr *) &sin, sinLen) != 0) {
+    fprintf(stderr, "could not open the UDP sockets: %s\n", strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  const int numMessages = (argc > 1) ? atoi(argv[1]) : 1000000;
+  const int mtu = (argc > 2) ? atoi(argv[2]) : 1472;
+  if (numMessages <= 0 || mtu < 20 || mtu > 65507) {
+    fprintf(stderr, "usage: %s [messages] [mtu]\n", argv[0]);
+    return 1;
+  }
+
+  sender plain;
+  if (openSender(&plain) != 0) return 1;
+  char buffer[64];
+  uint64_t start = getCpuNanoseconds();
+  for (int i = 0; i < numMessages; ++i) {
+    const uint32_t len = tosc_writeMessage(buffer, sizeof(buffer),
+        "/mixer/ch/fader", "f", (float) i);
+    sendPacket(&plain, buffer, len);
+  }
+  report("unbundled", &plain, numMessages,
+      getCpuNanoseconds() - start - plain.drainCpu);
+  close(plain.fd);
+  close(plain.receiver);
+
+  // messages are encoded in place in the bundle
+  sender bundled;
+  if (openSender(&bundled) != 0) return 1;
+  char *bundleBuffer = (char *) malloc(mtu);
+  tosc_bundler bundler;
+  tosc_initBundler(&bundler, bundleBuffer, (uint32_t) mtu, UINT64_MAX / 2,
+      flushBundle, &bundled);
+  start = getCpuNanoseconds();
+  for (int i = 0; i < numMessages; ++i) {
+    tosc_writeBundledMessage(&bundler, 0, "/mixer/ch/fader", "f", (float) i);
+  }
+  tosc_flushBundler(&bundler);
+  report("bundled", &bundled, numMessages,
+      getCpuNanoseconds() - start - bundled.drainCpu);
+  close(bundled.fd);
+  close(bundled.receiver);
+  free(bundleBuffer);
+  return 0;
+}
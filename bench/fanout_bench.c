@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * Sends one message to many loopback receivers, once with a plain sendto
+ * loop and once with tosc_sendFanout, and reports system calls and CPU time
+ * per destination.
+ *
+ *   fanout_bench [destinations] [rounds]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../tinyosc.h"
+#include "../tinyosc_fanout.h"
+
+// the receivers are drained every few rounds, so that their buffers never fill
+#define DRAIN_INTERVAL 8
+
+static uint64_t getCpuNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t drain(const int *receivers, const int numReceivers) {
+  char buffer[256];
+  uint64_t received = 0;
+  for (int i = 0; i < numReceivers; ++i) {
+    while (recv(receivers[i], buffer, sizeof(buffer), 0) > 0) received++;
+  }
+  return received;
+}
+
+static void report(const char *name, const int numDestinations, const int rounds,
+    uint64_t syscalls, uint64_t cpu, uint64_t received) {
+  const double sends = (double) numDestinations * rounds;
+  printf("%-12s %.3f syscalls/dest, %.0f ns CPU/dest, %llu of %.0f received\n",
+      name, syscalls / sends, cpu / sends, (unsigned long long) received, sends);
+}
+
+int main(int argc, char *argv[]) {
+  const int numDestinations = (argc > 1) ? atoi(argv[1]) : 50;
+  const int rounds = (argc > 2) ? atoi(argv[2]) : 20000;
+  if (numDestinations <= 0 || rounds <= 0) {
+    fprintf(stderr, "usage: %s [destinations] [rounds]\n", argv[0]);
+    return 1;
+  }
+
+  int *receivers = (int *) malloc(numDestinations * sizeof(int));
+  tosc_destination *destinations =
+      (tosc_destination *) malloc(numDestinations * sizeof(tosc_destination));
+  tosc_fanout fanout;
+  tosc_initFanout(&fanout, destinations, numDestinations, 1000000, 1000000000);
+  for (int i = 0; i < numDestinations; ++i) {
+    struct sockaddr_in sin;
+    socklen_t sinLen = sizeof(sin);
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    receivers[i] = socket(AF_INET, SOCK_DGRAM, 0);
+    fcntl(receivers[i], F_SETFL, O_NONBLOCK);
+    if (bind(receivers[i], (struct sockaddr *) &sin, sizeof(sin)) != 0 ||
+        getsockname(receivers[i], (struct sockaddr *) &sin, &sinLen) != 0) {
+      fprintf(stderr, "could not open receiver %d: %s\n", i, strerror(errno));
+      return 1;
+    }
+    tosc_addFanoutDestination(&fanout, (struct sockaddr *) &sin, sinLen);
+  }
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  char buffer[64];
+  const uint32_t len = tosc_writeMessage(buffer, sizeof(buffer), "/fader/1", "f", 0.5f);
+  printf("%d destinations, %d rounds, %u byte message\n", numDestinations, rounds, len);
+
+  // a plain sendto per destination, as an application would without fan-out
+  uint64_t cpu = 0;
+  uint64_t syscalls = 0;
+  uint64_t received = 0;
+  for (int r = 0; r < rounds; ++r) {
+    const uint64_t start = getCpuNanoseconds();
+    for (int i = 0; i < numDestinations; ++i) {
+      sendto(fd, buffer, len, 0, (struct sockaddr *) &destinations[i].addr,
+          destinations[i].addrLen);
+      syscalls++;
+    }
+    cpu += getCpuNanoseconds() - start;
+    if (r % DRAIN_INTERVAL == DRAIN_INTERVAL - 1) received += drain(receivers, numDestinations);
+  }
+  received += drain(receivers, numDestinations);
+  report("sendto loop", numDestinations, rounds, syscalls, cpu, received);
+
+  cpu = 0;
+  received = 0;
+  fanout.numSyscalls = 0;
+  for (int r = 0; r < rounds; ++r) {
+    const uint64_t start = getCpuNanoseconds();
+    tosc_sendFanout(&fanout, fd, buffer, len, (uint64_t) r);
+    cpu += getCpuNanoseconds() - start;
+    if (r % DRAIN_INTERVAL == DRAIN_INTERVAL - 1) received += drain(receivers, numDestinations);
+  }
+  received += drain(receivers, numDestinations);
+  report("fanout", numDestinations, rounds, fanout.numSyscalls, cpu, received);
+
+  close(fd);
+  for (int i = 0; i < numDestinations; ++i) close(receivers[i]);
+  free(receivers);
+  free(destinations);
+  return 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * Sends stamped bundles over loopback from two senders, one of which waits
+ * before sending, and checks the statistics which the receiver records with
+ * kernel receive timestamps against the latencies it computes itself.
+ * Exits with 1 if any check fails.
+ *
+ *   latency_selftest [bundles per sender]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../tinyosc.h"
+#include "../tinyosc_latency.h"
+
+// how long the second sender waits between stamping and sending
+#define DELAY_US 2000
+// one in this many bundles is sent untimed, and must not be recorded
+#define IMMEDIATE_INTERVAL 10
+
+static int numFailures = 0;
+
+static void check(const bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    numFailures++;
+  }
+}
+
+static int compareDouble(const void *a, const void *b) {
+  const double x = *(const double *) a;
+  const double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+static int openSocket(struct sockaddr_in *sin) {
+  socklen_t sinLen = sizeof(struct sockaddr_in);
+  memset(sin, 0, sizeof(struct sockaddr_in));
+  sin->sin_family = AF_INET;
+  sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0 || bind(fd, (struct sockaddr *) sin, sinLen) != 0 ||
+      getsockname(fd, (struct sockaddr *) sin, &sinLen) != 0) return -1;
+  return fd;
+}
+
+// sends one bundle and receives it. Returns the latency computed from the
+// bundle's own timetag, or -1 if nothing was received
+static double sendAndReceive(const int sender, const int receiver,
+    const struct sockaddr_in *to, const bool immediate, const bool delayed,
+    tosc_latencyStats *stats) {
+  char buffer[256];
+  tosc_bundle bundle;
+  if (immediate) tosc_writeBundle(&bundle, TINYOSC_TIMETAG_IMMEDIATELY, buffer, sizeof(buffer));
+  else tosc_writeStampedBundle(&bundle, buffer, sizeof(buffer));
+  tosc_writeNextMessage(&bundle, "/ping", "i", 1);
+  if (delayed) {
+    const struct timespec ts = {0, DELAY_US * 1000L};
+    nanosleep(&ts, NULL);
+  }
+  sendto(sender, buffer, tosc_getBundleLength(&bundle), 0,
+      (const struct sockaddr *) to, sizeof(struct sockaddr_in));
+
+  struct sockaddr_storage from;
+  socklen_t fromLen = sizeof(from);
+  uint64_t received;
+  const int len = tosc_receiveTimestamped(receiver, buffer, sizeof(buffer),
+      (struct sockaddr *) &from, &fromLen, &received);
+  const uint64_t now = tosc_getTimetagNow();
+  if (len <= 0) return -1.0;
+
+  tosc_parseBundle(&bundle, buffer, len);
+  const uint64_t sent = tosc_getTimetag(&bundle);
+  tosc_latencySource *src = tosc_recordLatency(stats,
+      (struct sockaddr *) &from, fromLen, sent, received);
+  if (immediate) {
+    check(src == NULL, "an untimed bundle was recorded");
+    return 0.0;
+  }
+  check(src != NULL, "a stamped bundle was not recorded");
+  check(received <= now, "the receive timestamp is later than the time it was read");
+  check(sent <= received, "a bundle was received before it was sent");
+  return tosc_getTimetagDifference(sent, received);
+}
+
+// compares the statistics of a sender with the latencies measured directly
+static void checkSource(const char *name, const tosc_latencySource *src,
+    double *latencies, const int count) {
+  char what[128];
+  if (src == NULL) {
+    snprintf(what, sizeof(what), "%s: no statistics were recorded", name);
+    check(false, what);
+    return;
+  }
+  qsort(latencies, count, sizeof(double), compareDouble);
+  snprintf(what, sizeof(what), "%s: count %llu instead of %d", name,
+      (unsigned long long) src->count, count);
+  check(src->count == (uint64_t) count, what);
+  snprintf(what, sizeof(what), "%s: min is not the smallest latency", name);
+  check(src->min == latencies[0], what);
+  snprintf(what, sizeof(what), "%s: max is not the largest latency", name);
+  check(src->max == latencies[count - 1], what);
+  snprintf(what, sizeof(what), "%s: the mean is outside of min and max", name);
+  check(src->mean >= src->min && src->mean <= src->max, what);
+  snprintf(what, sizeof(what), "%s: negative standard deviation", name);
+  check(tosc_getLatencyStdDev(src) >= 0.0, what);
+
+  // a percentile is the upper bound of the histogram bucket holding the
+  // latency of that rank, so it lies within a factor of two above it
+  const double percentiles[] = {50.0, 90.0, 99.0, 100.0};
+  printf("%-8s %d bundles, min %.1f us, max %.1f us, mean %.1f us", name,
+      count, src->min * 1e6, src->max * 1e6, src->mean * 1e6);
+  for (int i = 0; i < 4; ++i) {
+    const double p = percentiles[i];
+    int rank = (int) (p / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    const double exact = latencies[rank - 1];
+    const double bound = tosc_getLatencyPercentile(src, p);
+    printf(", p%.0f < %.0f us", p, bound * 1e6);
+    snprintf(what, sizeof(what), "%s: p%.0f bound %.1f us does not hold %.1f us",
+        name, p, bound * 1e6, exact * 1e6);
+    check(exact < bound && (bound <= 1e-6 || exact >= bound / 2.0), what);
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  const int count = (argc > 1) ? atoi(argv[1]) : 1000;
+  if (count <= 0) {
+    fprintf(stderr, "usage: %s [bundles per sender]\n", argv[0]);
+    return 1;
+  }
+  struct sockaddr_in receiverAddr;
+  struct sockaddr_in promptAddr;
+  struct sockaddr_in delayedAddr;
+  const int receiver = openSocket(&receiverAddr);
+  const int prompt = openSocket(&promptAddr);
+  const int delayed = openSocket(&delayedAddr);
+  if (receiver < 0 || prompt < 0 || delayed < 0) {
+    fprintf(stderr, "could not open the UDP sockets\n");
+    return 1;
+  }
+  const struct timeval tv = {1, 0};
+  setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  const bool kernelTimestamps = tosc_enableReceiveTimestamps(receiver) == 0;
+  printf("receive timestamps from the %s\n", kernelTimestamps ? "kernel" : "application");
+
+  tosc_latencySource sources[4];
+  tosc_latencyStats stats;
+  tosc_initLatencyStats(&stats, sources, 4);
+  double *promptLatencies = (double *) malloc(count * sizeof(double));
+  double *delayedLatencies = (double *) malloc(count * sizeof(double));
+  int numPrompt = 0;
+  int numDelayed = 0;
+  for (int i = 0; i < count; ++i) {
+    if (i % IMMEDIATE_INTERVAL == 0) {
+      check(sendAndReceive(prompt, receiver, &receiverAddr, true, false, &stats) >= 0.0,
+          "an untimed bundle was lost");
+    }
+    double latency = sendAndReceive(prompt, receiver, &receiverAddr, false, false, &stats);
+    if (latency >= 0.0) promptLatencies[numPrompt++] = latency;
+    latency = sendAndReceive(delayed, receiver, &receiverAddr, false, true, &stats);
+    if (latency >= 0.0) delayedLatencies[numDelayed++] = latency;
+  }
+  check(numPrompt == count && numDelayed == count, "bundles were lost on loopback");
+  check(stats.numSources == 2, "the two senders were not told apart");
+
+  const tosc_latencySource *promptSource = tosc_findLatencySource(&stats,
+      (struct sockaddr *) &promptAddr, sizeof(promptAddr));
+  const tosc_latencySource *delayedSource = tosc_findLatencySource(&stats,
+      (struct sockaddr *) &delayedAddr, sizeof(delayedAddr));
+  if (numPrompt > 0) checkSource("prompt", promptSource, promptLatencies, numPrompt);
+  if (numDelayed > 0) checkSource("delayed", delayedSource, delayedLatencies, numDelayed);
+  if (promptSource != NULL && delayedSource != NULL) {
+    check(delayedSource->min >= DELAY_US / 1e6,
+        "delayed: min is shorter than the delay before sending");
+    check(promptSource->mean < delayedSource->mean,
+        "prompt: the mean is not below the one of the delayed sender");
+  }
+
+  free(promptLatencies);
+  free(delayedLatencies);
+  close(receiver);
+  close(prompt);
+  close(delayed);
+  printf("%s\n", (numFailures == 0) ? "OK" : "FAILED");
+  return (numFailures == 0) ? 0 : 1;
+}
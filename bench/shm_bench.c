@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * Compares the shared memory ring with loopback UDP between two processes.
+ * Latency is half the round trip of a ping-pong, throughput is measured by
+ * the receiving process while the sender sends as fast as it can.
+ *
+ *   shm_bench [round trips] [packets]
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../tinyosc.h"
+#include "../tinyosc_shm.h"
+
+#define RING_CAPACITY (1 << 20)
+// how long either side waits for the other before giving up
+#define TIMEOUT_MS 5000
+
+static uint64_t getNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static int compareUint64(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *) a;
+  const uint64_t y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+// a transport is either a pair of rings or a pair of connected UDP sockets
+typedef struct transport {
+  tosc_shm in;
+  tosc_shm out;
+  int fd;
+  char buffer[2048];
+} transport;
+
+// returns false if the packet could not be sent in time
+static bool sendPacket(transport *t, const char *buffer, const uint32_t len) {
+  if (t->fd >= 0) {
+    send(t->fd, buffer, len, 0);
+    return true;
+  }
+  // the ring never drops, the sender waits for room instead. It sleeps
+  // after a while so that it does not starve the receiver on a single core
+  const uint64_t start = getNanoseconds();
+  for (int attempt = 0; tosc_sendShm(&t->out, buffer, len) < 0; ++attempt) {
+    if (attempt < 100) {
+      sched_yield();
+    } else {
+      if (getNanoseconds() - start > TIMEOUT_MS * 1000000ULL) return false;
+      const struct timespec ts = {0, 50000};
+      nanosleep(&ts, NULL);
+    }
+  }
+  return true;
+}
+
+// returns the length of the next packet, or 0 after waiting for timeoutMs
+static int receivePacket(transport *t, char **buffer, const int timeoutMs) {
+  if (t->fd >= 0) {
+    struct timeval tv = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    setsockopt(t->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    const int len = (int) recv(t->fd, t->buffer, sizeof(t->buffer), 0);
+    *buffer = t->buffer;
+    return (len > 0) ? len : 0;
+  }
+  return tosc_receiveShm(&t->in, buffer, timeoutMs);
+}
+
+// the child process: echoes numRoundTrips packets, then counts packets until "/end"
+static void runChild(transport *t, const int numRoundTrips, const int pipeFd) {
+  char *buffer;
+  int len;
+  for (int i = 0; i < numRoundTrips; ++i) {
+    if ((len = receivePacket(t, &buffer, TIMEOUT_MS)) <= 0) break;
+    sendPacket(t, buffer, (uint32_t) len);
+  }
+  uint64_t count = 0;
+  uint64_t first = 0;
+  uint64_t last = 0;
+  while ((len = receivePacket(t, &buffer, TIMEOUT_MS)) > 0) {
+    if (strcmp(buffer, "/end") == 0) break;
+    last = getNanoseconds();
+    if (count++ == 0) first = last;
+  }
+  const uint64_t result[2] = {count, last - first};
+  write(pipeFd, result, sizeof(result));
+}
+
+static void runParent(const char *name, transport *t, const int numRoundTrips,
+    const int numPackets, const int pipeFd) {
+  char message[64];
+  const uint32_t len = tosc_writeMessage(message, sizeof(message), "/fader/1", "f", 0.5f);
+  uint64_t *times = (uint64_t *) malloc(numRoundTrips * sizeof(uint64_t));
+  int completed = 0;
+  for (int i = 0; i < numRoundTrips; ++i) {
+    char *buffer;
+    const uint64_t start = getNanoseconds();
+    if (!sendPacket(t, message, len) || receivePacket(t, &buffer, TIMEOUT_MS) <= 0) break;
+    times[completed++] = (getNanoseconds() - start) / 2;
+  }
+  qsort(times, completed, sizeof(uint64_t), compareUint64);
+
+  for (int i = 0; i < numPackets; ++i) {
+    if (!sendPacket(t, message, len)) break;
+  }
+  char end[16];
+  const uint32_t endLen = tosc_writeMessage(end, sizeof(end), "/end", "");
+  for (int i = 0; i < 3; ++i) sendPacket(t, end, endLen); // UDP may lose one
+
+  uint64_t result[2] = {0, 0};
+  read(pipeFd, result, sizeof(result));
+  if (completed > 0) {
+    printf("%-5s latency: median %llu ns, p99 %llu ns (%d round trips)\n", name,
+        (unsigned long long) times[completed / 2],
+        (unsigned long long) times[completed * 99 / 100], completed);
+  }
+  printf("%-5s throughput: %.0f packets/s, %llu of %d received\n", name,
+      (result[1] > 0) ? result[0] * 1e9 / result[1] : 0.0,
+      (unsigned long long) result[0], numPackets);
+  free(times);
+}
+
+static int openUdpPair(int fds[2]) {
+  struct sockaddr_in sin[2];
+  socklen_t sinLen = sizeof(struct sockaddr_in);
+  for (int i = 0; i < 2; ++i) {
+    memset(&sin[i], 0, sizeof(sin[i]));
+    sin[i].sin_family = AF_INET;
+    sin[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+    const int size = 4 << 20;
+    setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    if (bind(fds[i], (struct sockaddr *) &sin[i], sinLen) != 0 ||
+        getsockname(fds[i], (struct sockaddr *) &sin[i], &sinLen) != 0) return -1;
+  }
+  if (connect(fds[0], (struct sockaddr *) &sin[1], sinLen) != 0 ||
+      connect(fds[1], (struct sockaddr *) &sin[0], sinLen) != 0) return -1;
+  return 0;
+}
+
+static void runBenchmark(const char *name, transport *parent, transport *child,
+    const int numRoundTrips, const int numPackets) {
+  int pipeFds[2];
+  if (pipe(pipeFds) != 0) return;
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (pid == 0) {
+    runChild(child, numRoundTrips, pipeFds[1]);
+    _exit(0);
+  }
+  runParent(name, parent, numRoundTrips, numPackets, pipeFds[0]);
+  waitpid(pid, NULL, 0);
+  close(pipeFds[0]);
+  close(pipeFds[1]);
+}
+
+int main(int argc, char *argv[]) {
+  const int numRoundTrips = (argc > 1) ? atoi(argv[1]) : 10000;
+  const int numPackets = (argc > 2) ? atoi(argv[2]) : 1000000;
+  if (numRoundTrips <= 0 || numPackets <= 0) {
+    fprintf(stderr, "usage: %s [round trips] [packets]\n", argv[0]);
+    return 1;
+  }
+  static transport parent;
+  static transport child;
+
+  // one ring in each direction, named after this process so runs don't collide
+  char up[64];
+  char down[64];
+  snprintf(up, sizeof(up), "/tinyosc_bench_up_%d", (int) getpid());
+  snprintf(down, sizeof(down), "/tinyosc_bench_down_%d", (int) getpid());
+  if (tosc_openShm(&parent.out, up, RING_CAPACITY, true) != 0 ||
+      tosc_openShm(&parent.in, down, RING_CAPACITY, true) != 0 ||
+      tosc_openShm(&child.in, up, 0, false) != 0 ||
+      tosc_openShm(&child.out, down, 0, false) != 0) {
+    fprintf(stderr, "could not open the shared memory rings\n");
+    return 1;
+  }
+  parent.fd = -1;
+  child.fd = -1;
+  runBenchmark("shm", &parent, &child, numRoundTrips, numPackets);
+  tosc_closeShm(&parent.out, up, true);
+  tosc_closeShm(&parent.in, down, true);
+  tosc_closeShm(&child.in, up, false);
+  tosc_closeShm(&child.out, down, false);
+
+  int fds[2];
+  if (openUdpPair(fds) != 0) {
+    fprintf(stderr, "could not open the UDP sockets\n");
+    return 1;
+  }
+  parent.fd = fds[0];
+  child.fd = fds[1];
+  runBenchmark("udp", &parent, &child, numRoundTrips, numPackets);
+  close(fds[0]);
+  close(fds[1]);
+  return 0;
+}
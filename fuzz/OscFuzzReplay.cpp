@@ -0,0 +1,120 @@
+// Runs a corpus through the fuzz target without libFuzzer, and reports how
+// long each parser took on each input.
+//
+//   osc_replay [-repeat=N] [-quiet] <file or directory>...
+//   osc_replay -seed=DIR
+
+#include "OscFuzzTarget.h"
+
+#include "../tinyosc.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+    void writeSeed(const std::filesystem::path& dir, const char* name, const char* data, size_t size) {
+        std::ofstream file(dir / name, std::ios::binary);
+        file.write(data, (std::streamsize)size);
+    }
+
+    // a few valid packets covering every type, to start the fuzzer from
+    void writeSeeds(const char* dir) {
+        std::filesystem::create_directories(dir);
+        char buffer[1024];
+        char blob[5] = {1, 2, 3, 4, 5};
+        unsigned char midi[4] = {0, 0x90, 60, 100};
+        uint32_t len = tosc_writeMessage(buffer, sizeof(buffer), "/numbers", "ifhdt",
+            -1, 1.5f, (long long)1 << 40, 2.25, (long long)1 << 32);
+        writeSeed(dir, "numbers", buffer, len);
+        len = tosc_writeMessage(buffer, sizeof(buffer), "/data", "sbmcr",
+            "hello", (int)sizeof(blob), blob, midi, 'x', 0xFF8000FF);
+        writeSeed(dir, "data", buffer, len);
+        len = tosc_writeMessage(buffer, sizeof(buffer), "/flags", "TFNI");
+        writeSeed(dir, "flags", buffer, len);
+        len = tosc_writeMessage(buffer, sizeof(buffer), "/array", "[ii][]f", 1, 2, 3.0f);
+        writeSeed(dir, "array", buffer, len);
+
+        tosc_bundle bundle;
+        tosc_writeBundle(&bundle, 1, buffer, sizeof(buffer));
+        tosc_writeNextMessage(&bundle, "/a", "i", 1);
+        tosc_writeNextMessage(&bundle, "/b", "s", "two");
+        tosc_writeNextMessage(&bundle, "/c", "");
+        writeSeed(dir, "bundle", buffer, tosc_getBundleLength(&bundle));
+    }
+
+    void collectInputs(const char* argument, std::vector<std::filesystem::path>& inputs) {
+        std::filesystem::path path(argument);
+        if (std::filesystem::is_directory(path)) {
+            for (auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                if (entry.is_regular_file()) inputs.push_back(entry.path());
+            }
+        }
+        else inputs.push_back(path);
+    }
+
+}
+
+
+int main(int argc, char* argv[]) {
+    int repeat = 1;
+    bool quiet = false;
+    std::vector<std::filesystem::path> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-repeat=", 8) == 0) repeat = std::max(1, atoi(argv[i] + 8));
+        else if (strcmp(argv[i], "-quiet") == 0) quiet = true;
+        else if (strncmp(argv[i], "-seed=", 6) == 0) {
+            writeSeeds(argv[i] + 6);
+            return 0;
+        }
+        else collectInputs(argv[i], inputs);
+    }
+    if (inputs.empty()) {
+        fprintf(stderr, "usage: %s [-repeat=N] [-quiet] <file or directory>...\n"
+            "       %s -seed=DIR\n", argv[0], argv[0]);
+        return 1;
+    }
+    std::sort(inputs.begin(), inputs.end());
+
+    uint64_t totalBytes = 0;
+    uint64_t totalMessages = 0;
+    uint64_t totalC = 0;
+    uint64_t totalCpp = 0;
+    for (auto& path : inputs) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        // the fastest of several runs is the least disturbed by the rest of the system
+        uint64_t bestC = UINT64_MAX;
+        uint64_t bestCpp = UINT64_MAX;
+        for (int i = 0; i < repeat; i++) {
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+            bestC = std::min(bestC, getLastFuzzTiming().parseMessage);
+            bestCpp = std::min(bestCpp, getLastFuzzTiming().getOscMessages);
+        }
+        size_t numMessages = getLastFuzzTiming().numMessages;
+        if (!quiet) {
+            printf("%s: %zu bytes, %zu messages, C %llu ns, C++ %llu ns\n", path.string().c_str(),
+                data.size(), numMessages, (unsigned long long)bestC, (unsigned long long)bestCpp);
+        }
+        totalBytes += data.size();
+        totalMessages += numMessages;
+        totalC += bestC;
+        totalCpp += bestCpp;
+    }
+
+    printf("%zu inputs, %llu bytes, %llu messages\n", inputs.size(),
+        (unsigned long long)totalBytes, (unsigned long long)totalMessages);
+    printf("C:   %llu ns, %.1f MB/s\n", (unsigned long long)totalC,
+        totalC > 0 ? 1000.0 * totalBytes / totalC : 0.0);
+    printf("C++: %llu ns, %.1f MB/s\n", (unsigned long long)totalCpp,
+        totalCpp > 0 ? 1000.0 * totalBytes / totalCpp : 0.0);
+    return 0;
+}
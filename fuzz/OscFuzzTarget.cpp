@@ -0,0 +1,339 @@
+#include "OscFuzzTarget.h"
+
+#include "../tinyosc.h"
+#include "../tinyosc_format.h"
+#include "../OscMessage.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// larger inputs cannot arrive in a single UDP datagram
+#define OSC_FUZZ_MAX_INPUT 65536
+
+// inputs taking longer than this to parse are saved, unless set by TINYOSC_FUZZ_SLOW_US
+#define OSC_FUZZ_SLOW_MICROSECONDS 10000
+
+
+namespace {
+
+    OscFuzzTiming lastTiming;
+
+    volatile uint64_t sink;
+
+    uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    // decodes every argument, as a receiver would
+    void readArguments(tosc_message* message) {
+        uint64_t sum = 0;
+        for (const char* f = tosc_getFormat(message); *f != '\0'; f++) {
+            switch (*f) {
+            case 'b': {
+                const char* data;
+                int size;
+                tosc_getNextBlob(message, &data, &size);
+                sum += (uint64_t)size;
+                break;
+            }
+            case 'f': sum += (uint64_t)tosc_getNextFloat(message); break;
+            case 'd': sum += (uint64_t)tosc_getNextDouble(message); break;
+            case 'i': sum += (uint64_t)tosc_getNextInt32(message); break;
+            case 'h': sum += (uint64_t)tosc_getNextInt64(message); break;
+            case 't': sum += tosc_getNextTimetag(message); break;
+            case 'c': sum += (uint64_t)tosc_getNextChar(message); break;
+            case 'r': sum += tosc_getNextRgba(message); break;
+            case 'm': sum += (uint64_t)(uintptr_t)tosc_getNextMidi(message); break;
+            case 's': sum += (uint64_t)(uintptr_t)tosc_getNextString(message); break;
+            default: break;
+            }
+        }
+        sink = sum;
+    }
+
+    // the same packet handling as OscPacket::getOscMessages, on the C API only
+    template <typename F>
+    size_t forEachMessage(char* buffer, size_t size, F callback) {
+        size_t count = 0;
+        tosc_message message;
+        if (size >= 16 && tosc_isBundle(buffer)) {
+            tosc_bundle bundle;
+            tosc_parseBundle(&bundle, buffer, (int)size);
+            while (tosc_getNextMessage(&bundle, &message)) {
+                callback(&message);
+                count++;
+            }
+        }
+        else if (0 == tosc_parseMessage(&message, buffer, (int)size)) {
+            callback(&message);
+            count++;
+        }
+        return count;
+    }
+
+    // OscMessage keeps strings and addresses in fixed size buffers
+    void appendText(std::string& out, const char* s, size_t maxLength) {
+        char escaped[8];
+        for (size_t i = 0; s != nullptr && i < maxLength && s[i] != '\0'; i++) {
+            unsigned char c = (unsigned char)s[i];
+            if (c >= 0x20 && c < 0x7F && c != '\\') out.push_back((char)c);
+            else {
+                snprintf(escaped, sizeof(escaped), "\\x%02X", c);
+                out += escaped;
+            }
+        }
+    }
+
+    void appendHex(std::string& out, uint64_t value) {
+        char hex[24];
+        snprintf(hex, sizeof(hex), "%llX", (unsigned long long)value);
+        out += hex;
+    }
+
+    void appendBytes(std::string& out, const char* data, int size) {
+        char hex[4];
+        for (int i = 0; i < size; i++) {
+            snprintf(hex, sizeof(hex), "%02X", (unsigned char)data[i]);
+            out += hex;
+        }
+    }
+
+    const size_t maxAddressLength = OscAddressTable::MAX_ADDRESS_LENGTH - 1;
+    const size_t maxStringLength = sizeof(OscString::data) - 1;
+
+    // describes the arguments which OscMessage keeps, read with the C API
+    std::string describe(tosc_message* message) {
+        std::string out;
+        appendText(out, tosc_getAddress(message), maxAddressLength);
+        for (const char* f = tosc_getFormat(message); *f != '\0'; f++) {
+            out.push_back(' ');
+            switch (*f) {
+            case 'b': {
+                const char* data;
+                int size;
+                tosc_getNextBlob(message, &data, &size);
+                out += "b";
+                appendBytes(out, data, size);
+                break;
+            }
+            case 'f': {
+                float f = tosc_getNextFloat(message);
+                uint32_t bits;
+                memcpy(&bits, &f, 4);
+                out += "f";
+                appendHex(out, bits);
+                break;
+            }
+            case 'd': {
+                double d = tosc_getNextDouble(message);
+                uint64_t bits;
+                memcpy(&bits, &d, 8);
+                out += "d";
+                appendHex(out, bits);
+                break;
+            }
+            case 'i': out += "i" + std::to_string(tosc_getNextInt32(message)); break;
+            case 'h': out += "h" + std::to_string(tosc_getNextInt64(message)); break;
+            case 't': out += "t"; appendHex(out, tosc_getNextTimetag(message)); break;
+            case 'c': out += "c" + std::to_string((int)tosc_getNextChar(message)); break;
+            case 'r': out += "r"; appendHex(out, tosc_getNextRgba(message)); break;
+            case 'm': {
+                unsigned char* m = tosc_getNextMidi(message);
+                static const char none[4] = {0, 0, 0, 0};
+                out += "m";
+                appendBytes(out, (m != nullptr) ? (const char*)m : none, 4);
+                break;
+            }
+            case 's': out += "s"; appendText(out, tosc_getNextString(message), maxStringLength); break;
+            case 'T': out += "T"; break;
+            case 'F': out += "F"; break;
+            case '[': out += "["; break;
+            case ']': out += "]"; break;
+            default: out.pop_back(); break; // nil, infinitum and unknown types are not kept
+            }
+        }
+        return out;
+    }
+
+    // describes an OscMessage in the same way, using its getters
+    std::string describe(OscMessage& message) {
+        std::string out;
+        appendText(out, message.getAddress(), maxAddressLength);
+        for (int i = 0; i < message.getArgumentCount(); i++) {
+            out.push_back(' ');
+            if (message.isBlob(i)) {
+                char* data;
+                int size = message.getBlob(i, &data);
+                out += "b";
+                appendBytes(out, data, size);
+            }
+            else if (message.isFloat(i)) {
+                float f = message.getFloat(i);
+                uint32_t bits;
+                memcpy(&bits, &f, 4);
+                out += "f";
+                appendHex(out, bits);
+            }
+            else if (message.isDouble(i)) {
+                double d = message.getDouble(i);
+                uint64_t bits;
+                memcpy(&bits, &d, 8);
+                out += "d";
+                appendHex(out, bits);
+            }
+            else if (message.isInt32(i)) out += "i" + std::to_string(message.getInt32(i));
+            else if (message.isInt64(i)) out += "h" + std::to_string(message.getInt64(i));
+            else if (message.isTimetag(i)) { out += "t"; appendHex(out, message.getTimetag(i)); }
+            else if (message.isChar(i)) out += "c" + std::to_string((int)message.getChar(i));
+            else if (message.isRgba(i)) { out += "r"; appendHex(out, message.getRgba(i)); }
+            else if (message.isMidi(i)) {
+                char m[4];
+                message.getMidi(i, &m[0], &m[1], &m[2], &m[3]);
+                out += "m";
+                appendBytes(out, m, 4);
+            }
+            else if (message.isString(i)) { out += "s"; appendText(out, message.getString(i), maxStringLength); }
+            else if (message.isBool(i)) out += message.getBool(i) ? "T" : "F";
+            else if (message.isArrayBegin(i)) out += "[";
+            else if (message.isArrayEnd(i)) out += "]";
+            else out += "?";
+        }
+        return out;
+    }
+
+    [[noreturn]] void reportMismatch(const char* what, const std::string& expected, const std::string& actual) {
+        fprintf(stderr, "tinyosc parsers disagree on %s:\n  C:   %s\n  C++: %s\n",
+            what, expected.c_str(), actual.c_str());
+        abort();
+    }
+
+    // true if brackets and braces outside of strings are balanced
+    bool isBalancedJson(const char* json) {
+        std::string open;
+        bool inString = false;
+        for (const char* c = json; *c != '\0'; c++) {
+            if (inString) {
+                if (*c == '\\' && c[1] != '\0') c++;
+                else if (*c == '"') inString = false;
+            }
+            else if (*c == '"') inString = true;
+            else if (*c == '[' || *c == '{') open.push_back(*c);
+            else if (*c == ']' || *c == '}') {
+                if (open.empty() || open.back() != (*c == ']' ? '[' : '{')) return false;
+                open.pop_back();
+            }
+        }
+        return open.empty() && !inString;
+    }
+
+    // true if the text holds only printable ASCII
+    bool isPrintable(const char* text) {
+        for (const char* c = text; *c != '\0'; c++) {
+            if ((unsigned char)*c < 0x20 || (unsigned char)*c >= 0x7F) return false;
+        }
+        return true;
+    }
+
+    // renders the message as text and JSON, into a buffer large enough and one
+    // which is too small. Both formatters start reading with tosc_reset
+    void checkFormatting(tosc_message* message, const std::string& expected) {
+        std::vector<char> text(tosc_getLength(message) * 8 + 256);
+        char small[16];
+        if (tosc_formatMessage(message, text.data(), (int)text.size()) >= 0 && !isPrintable(text.data())) {
+            reportMismatch("tosc_formatMessage()", expected, text.data());
+        }
+        tosc_formatMessage(message, small, sizeof(small));
+        tosc_formatMessageJson(message, small, sizeof(small));
+        if (tosc_formatMessageJson(message, text.data(), (int)text.size()) >= 0 &&
+                (!isBalancedJson(text.data()) || !isPrintable(text.data()))) {
+            reportMismatch("tosc_formatMessageJson()", expected, text.data());
+        }
+    }
+
+    uint64_t slowThreshold() {
+        static uint64_t threshold = [] {
+            const char* value = getenv("TINYOSC_FUZZ_SLOW_US");
+            uint64_t us = (value != nullptr) ? strtoull(value, nullptr, 10) : OSC_FUZZ_SLOW_MICROSECONDS;
+            return us * 1000;
+        }();
+        return threshold;
+    }
+
+    // saves the input to TINYOSC_FUZZ_SLOW_DIR (default slow/), named by its hash
+    void saveSlowInput(const uint8_t* data, size_t size) {
+        const char* dir = getenv("TINYOSC_FUZZ_SLOW_DIR");
+        std::filesystem::path path = (dir != nullptr) ? dir : "slow";
+        std::error_code error;
+        std::filesystem::create_directories(path, error);
+        uint32_t hash = 0x811C9DC5;
+        for (size_t i = 0; i < size; i++) hash = (hash ^ data[i]) * 0x01000193;
+        char name[32];
+        snprintf(name, sizeof(name), "slow-%08x", hash);
+        std::ofstream file(path / name, std::ios::binary);
+        file.write((const char*)data, (std::streamsize)size);
+    }
+
+}
+
+
+const OscFuzzTiming& getLastFuzzTiming() {
+    return lastTiming;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size > OSC_FUZZ_MAX_INPUT) return 0;
+
+    // an exactly sized copy, so that ASan catches any read past the end
+    std::unique_ptr<char[]> buffer(new char[size > 0 ? size : 1]);
+    if (size > 0) memcpy(buffer.get(), data, size);
+
+    auto start = std::chrono::steady_clock::now();
+    lastTiming.numMessages = forEachMessage(buffer.get(), size, readArguments);
+    lastTiming.parseMessage = nanosecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<OscMessage>> messages = OscPacket::getOscMessages(buffer.get(), size);
+    lastTiming.getOscMessages = nanosecondsSince(start);
+
+    if (lastTiming.parseMessage > slowThreshold() || lastTiming.getOscMessages > slowThreshold()) {
+        saveSlowInput(data, size);
+    }
+
+    // compare what both layers decoded, then re-encode with the C++ layer
+    // and check that the C parser reads back the same message
+    size_t index = 0;
+    forEachMessage(buffer.get(), size, [&](tosc_message* message) {
+        std::string expected = describe(message);
+        checkFormatting(message, expected);
+        // reading again from the start must give the same arguments
+        std::string again = describe(tosc_reset(message));
+        if (expected != again) reportMismatch("a message read again after tosc_reset()", expected, again);
+        if (index >= messages.size()) reportMismatch("the number of messages", expected, "(missing)");
+        OscMessage& decoded = *messages[index++];
+        std::string actual = describe(decoded);
+        if (expected != actual) reportMismatch("a decoded message", expected, actual);
+
+        // each argument grows by at most 8 bytes when a cut off message is written out in full
+        std::vector<char> encoded(tosc_getLength(message) * 9 + 256);
+        int length = decoded.getBuffer(encoded.data(), (int)encoded.size());
+        if (length <= 0) reportMismatch("getBuffer()", expected, "(error " + std::to_string(length) + ")");
+        std::unique_ptr<char[]> exact(new char[length]);
+        memcpy(exact.get(), encoded.data(), length);
+        tosc_message reparsed;
+        if (0 != tosc_parseMessage(&reparsed, exact.get(), length)) {
+            reportMismatch("a re-encoded message", expected, "(does not parse)");
+        }
+        actual = describe(&reparsed);
+        if (expected != actual) reportMismatch("a re-encoded message", expected, actual);
+    });
+    if (index != messages.size()) reportMismatch("the number of messages", std::to_string(index), std::to_string(messages.size()));
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// how long each parser took on the last input, in nanoseconds
+struct OscFuzzTiming {
+	uint64_t parseMessage = 0;	// tosc_parseMessage and tosc_getNextMessage
+	uint64_t getOscMessages = 0;	// OscPacket::getOscMessages
+	size_t numMessages = 0;
+};
+
+const OscFuzzTiming& getLastFuzzTiming();
+
+// feeds one input to the C and C++ parsers and aborts if they disagree
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
@@ -0,0 +1,28 @@
+#!/bin/bash
+# Builds the differential fuzzer of the C and C++ parsers.
+#   osc_fuzzer  libFuzzer target with ASan and UBSan (clang only)
+#   osc_replay  runs a corpus offline with ASan and UBSan, and reports parse times
+#   osc_bench   the same without sanitizers, for throughput numbers
+
+cd "$(dirname "$0")"
+CPP_SOURCES="OscFuzzTarget.cpp ../OscMessage.cpp ../OscAddressTable.cpp"
+SANITIZE="-fsanitize=address,undefined -fno-sanitize=alignment"
+
+if type "clang" > /dev/null 2>&1; then
+  clang -c ../tinyosc.c -O1 -g -fsanitize=fuzzer-no-link $SANITIZE -o tinyosc_fuzz.o
+  clang -c ../tinyosc_format.c -O1 -g -fsanitize=fuzzer-no-link $SANITIZE -o tinyosc_format_fuzz.o
+  clang++ -std=c++17 -O1 -g -fsanitize=fuzzer $SANITIZE $CPP_SOURCES tinyosc_fuzz.o tinyosc_format_fuzz.o -o osc_fuzzer
+  CC=clang
+  CXX=clang++
+else
+  CC="gcc -std=gnu99"
+  CXX=g++
+fi
+
+$CC -c ../tinyosc.c -O1 -g $SANITIZE -o tinyosc_replay.o
+$CC -c ../tinyosc_format.c -O1 -g $SANITIZE -o tinyosc_format_replay.o
+$CXX -std=c++17 -O1 -g $SANITIZE $CPP_SOURCES OscFuzzReplay.cpp tinyosc_replay.o tinyosc_format_replay.o -o osc_replay
+$CC -c ../tinyosc.c -O2 -o tinyosc_bench.o
+$CC -c ../tinyosc_format.c -O2 -o tinyosc_format_bench.o
+$CXX -std=c++17 -O2 $CPP_SOURCES OscFuzzReplay.cpp tinyosc_bench.o tinyosc_format_bench.o -o osc_bench
+rm -f tinyosc_*.o
@@ -20,9 +20,11 @@
 #include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "tinyosc.h"
+#include "tinyosc_session.h"
 
 static volatile bool keepRunning = true;
 
@@ -31,6 +33,13 @@ static void sigintHandler(int x) {
   keepRunning = false;
 }
 
+// the current time in milliseconds
+static uint64_t getMilliseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
 /**
  * A basic program to listen to port 9000 and print received OSC packets.
  */
@@ -60,16 +69,27 @@ int main(int argc, char *argv[]) {
   printf("tinyosc is now listening on port 9000.\n");
   printf("Press Ctrl+C to stop.\n");
 
+  // keep track of up to 64 senders, with rates counted per second
+  tosc_session sessions[64];
+  tosc_sessionTable table;
+  tosc_initSessionTable(&table, sessions, 64, 1000);
+
   while (keepRunning) {
     fd_set readSet;
     FD_ZERO(&readSet);
     FD_SET(fd, &readSet);
     struct timeval timeout = {1, 0}; // select times out after 1 second
     if (select(fd+1, &readSet, NULL, NULL, &timeout) > 0) {
-      struct sockaddr sa; // can be safely cast to sockaddr_in
-      socklen_t sa_len = sizeof(struct sockaddr_in);
+      struct sockaddr_storage sa; // can be safely cast to sockaddr_in
+      socklen_t sa_len = sizeof(sa);
       int len = 0;
-      while ((len = (int) recvfrom(fd, buffer, sizeof(buffer), 0, &sa, &sa_len)) > 0) {
+      while ((len = (int) recvfrom(fd, buffer, sizeof(buffer), 0,
+          (struct sockaddr *) &sa, &sa_len)) > 0) {
+        tosc_session *session = NULL;
+        const bool admit = tosc_admitPacket(&table, (struct sockaddr *) &sa,
+            sa_len, len, getMilliseconds(), &session);
+        sa_len = sizeof(sa);
+        if (!admit) continue; // the sender is over its rate limit
         if (tosc_isBundle(buffer)) {
           tosc_bundle bundle;
           tosc_parseBundle(&bundle, buffer, len);
@@ -78,10 +98,15 @@ int main(int argc, char *argv[]) {
           while (tosc_getNextMessage(&bundle, &osc)) {
             tosc_printMessage(&osc);
           }
+          // reading stops early at an element which is cut off
+          if (bundle.marker != bundle.buffer + len) tosc_addSessionError(session);
         } else {
           tosc_message osc;
-          tosc_parseMessage(&osc, buffer, len);
-          tosc_printMessage(&osc);
+          if (tosc_parseMessage(&osc, buffer, len) == 0) {
+            tosc_printMessage(&osc);
+          } else {
+            tosc_addSessionError(session);
+          }
         }
       }
     }
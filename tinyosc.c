@@ -33,22 +33,38 @@
 #include "tinyosc.h"
 
 #define BUNDLE_ID 0x2362756E646C6500L // "#bundle"
+#define FNV_OFFSET_BASIS 0x811C9DC5
+#define FNV_PRIME 0x01000193
+
+uint32_t tosc_hashAddress(const char *address) {
+  uint32_t h = FNV_OFFSET_BASIS;
+  for (int i = 0; address[i] != '\0'; ++i) {
+    h = (h ^ (unsigned char) address[i]) * FNV_PRIME;
+  }
+  return (h == 0) ? 1 : h;
+}
 
 // http://opensoundcontrol.org/spec-1_0
 int tosc_parseMessage(tosc_message *o, char *buffer, const int len) {
   // NOTE(mhroth): if there's a comma in the address, that's weird
   int i = 0;
-  while (buffer[i] != '\0') ++i; // find the null-terimated address
-  while (buffer[i] != ',') ++i; // find the comma which starts the format string
+  uint32_t h = FNV_OFFSET_BASIS; // hash the address while looking for its end
+  while (i < len && buffer[i] != '\0') { // find the null-terimated address
+    h = (h ^ (unsigned char) buffer[i]) * FNV_PRIME;
+    ++i;
+  }
+  o->hash = (h == 0) ? 1 : h; // same as tosc_hashAddress
+  // find the comma which starts the format string
+  while (i < len && buffer[i] != ',') ++i;
   if (i >= len) return -1; // error while looking for format string
   // format string is null terminated
   o->format = buffer + i + 1; // format starts after comma
 
   while (i < len && buffer[i] != '\0') ++i;
-  if (i == len) return -2; // format string not null terminated
+  if (i >= len) return -2; // format string not null terminated
 
   i = (i + 4) & ~0x3; // advance to the next multiple of 4 after trailing '\0'
-  o->marker = buffer + i;
+  o->marker = buffer + ((i < len) ? i : len); // no arguments if padding is cut off
 
   o->buffer = buffer;
   o->len = len;
@@ -77,17 +93,26 @@ uint32_t tosc_getBundleLength(tosc_bundle *b) {
 }
 
 bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o) {
-  if ((b->marker - b->buffer) >= b->bundleLen) return false;
-  uint32_t len = (uint32_t) ntohl(*((int32_t *) b->marker));
-  tosc_parseMessage(o, b->marker+4, len);
-  b->marker += (4 + len); // move marker to next bundle element
-  return true;
+  while ((b->marker - b->buffer) + 4 <= b->bundleLen) {
+    const uint32_t remaining = b->bundleLen - (uint32_t) (b->marker - b->buffer) - 4;
+    const uint32_t len = (uint32_t) ntohl(*((int32_t *) b->marker));
+    if (len > remaining) return false; // element is cut off
+    char *element = b->marker + 4;
+    b->marker += (4 + len); // move marker to next bundle element
+    // elements which are not messages, e.g. nested bundles, are skipped
+    if (tosc_parseMessage(o, element, (int) len) == 0) return true;
+  }
+  return false;
 }
 
 char *tosc_getAddress(tosc_message *o) {
   return o->buffer;
 }
 
+uint32_t tosc_getAddressHash(tosc_message *o) {
+  return o->hash;
+}
+
 char *tosc_getFormat(tosc_message *o) {
   return o->format;
 }
@@ -96,7 +121,16 @@ uint32_t tosc_getLength(tosc_message *o) {
   return o->len;
 }
 
+// true if n more bytes can be read from the message. Otherwise the message
+// is used up, so that later arguments are not read from the wrong offset.
+static bool tosc_hasBytes(tosc_message *o, const uint32_t n) {
+  if ((uint32_t) (o->buffer + o->len - o->marker) >= n) return true;
+  o->marker = o->buffer + o->len;
+  return false;
+}
+
 int32_t tosc_getNextInt32(tosc_message *o) {
+  if (!tosc_hasBytes(o, 4)) return 0;
   // convert from big-endian (network btye order)
   const int32_t i = (int32_t) ntohl(*((uint32_t *) o->marker));
   o->marker += 4;
@@ -104,6 +138,7 @@ int32_t tosc_getNextInt32(tosc_message *o) {
 }
 
 int64_t tosc_getNextInt64(tosc_message *o) {
+  if (!tosc_hasBytes(o, 8)) return 0;
   const int64_t i = (int64_t) ntohll(*((uint64_t *) o->marker));
   o->marker += 8;
   return i;
@@ -114,6 +149,7 @@ uint64_t tosc_getNextTimetag(tosc_message *o) {
 }
 
 float tosc_getNextFloat(tosc_message *o) {
+  if (!tosc_hasBytes(o, 4)) return 0.0f;
   // convert from big-endian (network btye order)
   const uint32_t i = ntohl(*((uint32_t *) o->marker));
   o->marker += 4;
@@ -121,44 +157,128 @@ float tosc_getNextFloat(tosc_message *o) {
 }
 
 double tosc_getNextDouble(tosc_message *o) {
+  if (!tosc_hasBytes(o, 8)) return 0.0;
   const uint64_t i = ntohll(*((uint64_t *) o->marker));
   o->marker += 8;
   return *((double *) (&i));
 }
 
 const char *tosc_getNextString(tosc_message *o) {
-  int i = (int) strlen(o->marker);
-  if (o->marker + i >= o->buffer + o->len) return NULL;
+  const uint32_t n = (uint32_t) (o->buffer + o->len - o->marker);
+  const char *end = (const char *) memchr(o->marker, '\0', n);
+  if (end == NULL) {
+    o->marker += n; // the message is used up
+    return NULL;
+  }
   const char *s = o->marker;
+  uint32_t i = (uint32_t) (end - s);
   i = (i + 4) & ~0x3; // advance to next multiple of 4 after trailing '\0'
-  o->marker += i;
+  o->marker += (i < n) ? i : n;
   return s;
 }
 
 void tosc_getNextBlob(tosc_message *o, const char **buffer, int *len) {
-  int i = (int) ntohl(*((uint32_t *) o->marker)); // get the blob length
-  if (o->marker + 4 + i <= o->buffer + o->len) {
-    *len = i; // length of blob
+  const uint32_t avail = (uint32_t) (o->buffer + o->len - o->marker);
+  const uint32_t n = (avail >= 4) ? ntohl(*((uint32_t *) o->marker)) : 0; // get the blob length
+  if (avail >= 4 && n <= avail - 4) {
+    *len = (int) n; // length of blob
     *buffer = o->marker + 4;
-    i = (i + 7) & ~0x3;
-    o->marker += i;
+    const uint32_t i = (n + 7) & ~0x3;
+    o->marker += (i < avail) ? i : avail;
   } else {
+    o->marker += avail; // the message is used up
     *len = 0;
     *buffer = NULL;
   }
 }
 
 unsigned char *tosc_getNextMidi(tosc_message *o) {
+  if (!tosc_hasBytes(o, 4)) return NULL;
   unsigned char *m = (unsigned char *) o->marker;
   o->marker += 4;
   return m;
 }
 
+char tosc_getNextChar(tosc_message *o) {
+  return (char) tosc_getNextInt32(o);
+}
+
+uint32_t tosc_getNextRgba(tosc_message *o) {
+  return (uint32_t) tosc_getNextInt32(o);
+}
+
+static int tosc_getTypeSize(const char type) {
+  switch (type) {
+    case 'i': case 'f': case 'c': case 'r': return 4;
+    case 'h': case 'd': case 't': return 8;
+    default: return 0; // not a fixed-size number
+  }
+}
+
+int tosc_getNextSpan(tosc_message *o, const char *format, tosc_span *s) {
+  if (format[0] != '[') return 0;
+  s->data = o->marker;
+  if (format[1] == ']') { // an empty array has no type
+    s->count = 0;
+    s->type = '\0';
+    return 2;
+  }
+  const char type = format[1];
+  const int size = tosc_getTypeSize(type);
+  if (size == 0) return 0;
+  int n = 1;
+  while (format[n] == type) ++n;
+  if (format[n] != ']') return 0; // mixed, nested or unterminated
+
+  const uint32_t count = (uint32_t) (n - 1);
+  if (!tosc_hasBytes(o, (uint32_t) size * count)) return -1;
+  s->count = count;
+  s->type = type;
+  o->marker += (size_t) size * count;
+  return n + 1;
+}
+
+// the loops below are kept simple so that the compiler can vectorize them
+void tosc_decodeInt32Span(const tosc_span *s, int32_t *out) {
+  for (uint32_t i = 0; i < s->count; ++i) {
+    uint32_t k;
+    memcpy(&k, s->data + 4*i, 4);
+    out[i] = (int32_t) ntohl(k);
+  }
+}
+
+void tosc_decodeFloatSpan(const tosc_span *s, float *out) {
+  for (uint32_t i = 0; i < s->count; ++i) {
+    uint32_t k;
+    memcpy(&k, s->data + 4*i, 4);
+    k = ntohl(k);
+    memcpy(out + i, &k, 4);
+  }
+}
+
+void tosc_decodeInt64Span(const tosc_span *s, int64_t *out) {
+  for (uint32_t i = 0; i < s->count; ++i) {
+    uint64_t k;
+    memcpy(&k, s->data + 8*i, 8);
+    out[i] = (int64_t) ntohll(k);
+  }
+}
+
+void tosc_decodeDoubleSpan(const tosc_span *s, double *out) {
+  for (uint32_t i = 0; i < s->count; ++i) {
+    uint64_t k;
+    memcpy(&k, s->data + 8*i, 8);
+    k = ntohll(k);
+    memcpy(out + i, &k, 8);
+  }
+}
+
 tosc_message *tosc_reset(tosc_message *o) {
-  int i = 0;
-  while (o->format[i] != '\0') ++i;
+  // the same as in tosc_parseMessage
+  int i = (int) (o->format - o->buffer);
+  while (i < o->len && o->buffer[i] != '\0') ++i;
   i = (i + 4) & ~0x3; // advance to the next multiple of 4 after trailing '\0'
-  o->marker = o->format + i - 1; // -1 to account for ',' format prefix
+  o->marker = o->buffer + ((i < o->len) ? i : o->len);
   return o;
 }
 
@@ -180,6 +300,7 @@ static uint32_t tosc_vwrite(char *buffer, const int len,
   if (address == NULL || i >= len) return -1;
   tosc_strncpy(buffer, address, len);
   i = (i + 4) & ~0x3;
+  if (i >= len) return -1; // no room for the format string
   buffer[i++] = ',';
   int s_len = (int) strlen(format);
   if (format == NULL || (i + s_len) >= len) return -2;
@@ -211,7 +332,9 @@ static uint32_t tosc_vwrite(char *buffer, const int len,
         i += 8;
         break;
       }
-      case 'i': {
+      case 'i':
+      case 'c':
+      case 'r': {
         if (i + 4 > len) return -3;
         const uint32_t k = (uint32_t) va_arg(ap, int);
         *((uint32_t *) (buffer+i)) = htonl(k);
@@ -245,6 +368,8 @@ static uint32_t tosc_vwrite(char *buffer, const int len,
       case 'F': // false
       case 'N': // nil
       case 'I': // infinitum
+      case '[': // array start
+      case ']': // array end
           break;
       default: return -4; // unknown type
     }
@@ -276,6 +401,11 @@ uint32_t tosc_writeMessage(char *buffer, const int len,
   return i; // return the total number of bytes written
 }
 
+uint32_t tosc_vwriteMessage(char *buffer, const int len,
+    const char *address, const char *format, va_list ap) {
+  return tosc_vwrite(buffer, len, address, format, ap);
+}
+
 void tosc_printOscBuffer(char *buffer, const int len) {
   // parse the buffer contents (the raw OSC bytes)
   // a return value of 0 indicates no error
@@ -303,12 +433,15 @@ void tosc_printMessage(tosc_message *osc) {
       }
       case 'm': {
         unsigned char *m = tosc_getNextMidi(osc);
-        printf(" 0x%02X%02X%02X%02X", m[0], m[1], m[2], m[3]);
+        if (m == NULL) printf(" (null)");
+        else printf(" 0x%02X%02X%02X%02X", m[0], m[1], m[2], m[3]);
         break;
       }
       case 'f': printf(" %g", tosc_getNextFloat(osc)); break;
       case 'd': printf(" %g", tosc_getNextDouble(osc)); break;
       case 'i': printf(" %d", tosc_getNextInt32(osc)); break;
+      case 'c': printf(" %c", tosc_getNextChar(osc)); break;
+      case 'r': printf(" 0x%08X", tosc_getNextRgba(osc)); break;
       case 'h': printf(" %lli", (long long)tosc_getNextInt64(osc)); break;
       case 't': printf(" %llu", (unsigned long long)tosc_getNextTimetag(osc)); break;
       case 's': printf(" %s", tosc_getNextString(osc)); break;
@@ -316,6 +449,8 @@ void tosc_printMessage(tosc_message *osc) {
       case 'I': printf(" inf"); break;
       case 'N': printf(" nil"); break;
       case 'T': printf(" true"); break;
+      case '[': printf(" ["); break;
+      case ']': printf(" ]"); break;
       default: printf(" Unknown format: '%c'", osc->format[i]); break;
     }
   }
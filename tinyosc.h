@@ -17,6 +17,7 @@
 #ifndef _TINY_OSC_
 #define _TINY_OSC_
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -31,8 +32,15 @@ typedef struct tosc_message {
   char *marker;  // the current read head
   char *buffer;  // the original message data (also points to the address)
   uint32_t len;  // length of the buffer data
+  uint32_t hash; // hash of the address, see tosc_hashAddress
 } tosc_message;
 
+typedef struct tosc_span {
+  const char *data; // the first element, in network byte order
+  uint32_t count; // the number of elements
+  char type; // the type tag shared by all elements
+} tosc_span;
+
 typedef struct tosc_bundle {
   char *marker; // the current write head (where the next message will be written)
   char *buffer; // the original buffer
@@ -59,7 +67,8 @@ uint64_t tosc_getTimetag(tosc_bundle *b);
 
 /**
  * Parses the next message in a bundle. Returns true if successful.
- * False otherwise.
+ * False otherwise. Elements which are not valid messages (e.g. nested
+ * bundles) are skipped, and a cut off element ends the bundle.
  */
 bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o);
 
@@ -69,6 +78,11 @@ bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o);
  */
 char *tosc_getAddress(tosc_message *o);
 
+/**
+ * Returns the hash of the address, computed while parsing the message.
+ */
+uint32_t tosc_getAddressHash(tosc_message *o);
+
 /**
  * Returns a pointer to the format block of the OSC buffer.
  */
@@ -80,27 +94,27 @@ char *tosc_getFormat(tosc_message *o);
 uint32_t tosc_getLength(tosc_message *o);
 
 /**
- * Returns the next 32-bit int. Does not check buffer bounds.
+ * Returns the next 32-bit int, or 0 if the buffer length is exceeded.
  */
 int32_t tosc_getNextInt32(tosc_message *o);
 
 /**
- * Returns the next 64-bit int. Does not check buffer bounds.
+ * Returns the next 64-bit int, or 0 if the buffer length is exceeded.
  */
 int64_t tosc_getNextInt64(tosc_message *o);
 
 /**
- * Returns the next 64-bit timetag. Does not check buffer bounds.
+ * Returns the next 64-bit timetag, or 0 if the buffer length is exceeded.
  */
 uint64_t tosc_getNextTimetag(tosc_message *o);
 
 /**
- * Returns the next 32-bit float. Does not check buffer bounds.
+ * Returns the next 32-bit float, or 0 if the buffer length is exceeded.
  */
 float tosc_getNextFloat(tosc_message *o);
 
 /**
- * Returns the next 64-bit float. Does not check buffer bounds.
+ * Returns the next 64-bit float, or 0 if the buffer length is exceeded.
  */
 double tosc_getNextDouble(tosc_message *o);
 
@@ -117,11 +131,48 @@ const char *tosc_getNextString(tosc_message *o);
 void tosc_getNextBlob(tosc_message *o, const char **buffer, int *len);
 
 /**
- * Returns the next set of midi bytes. Does not check bounds.
+ * Returns the next set of midi bytes, or NULL if the buffer length is exceeded.
  * Bytes from MSB to LSB are: port id, status byte, data1, data2.
  */
 unsigned char *tosc_getNextMidi(tosc_message *o);
 
+/**
+ * Returns the next ascii character, or 0 if the buffer length is exceeded.
+ */
+char tosc_getNextChar(tosc_message *o);
+
+/**
+ * Returns the next 32-bit RGBA color, or 0 if the buffer length is exceeded.
+ * Bytes from MSB to LSB are: red, green, blue, alpha.
+ */
+uint32_t tosc_getNextRgba(tosc_message *o);
+
+/**
+ * Reads a homogeneous array of numbers ('i', 'f', 'c', 'r', 'h', 'd' or 't')
+ * without copying it. format must point at the '[' opening the array in the
+ * format string. The read head is advanced past the array.
+ * Returns the number of format characters of the array, including the
+ * brackets, so that the caller can skip them.
+ * Returns 0 and reads nothing if the array is not homogeneous or contains
+ * other types, in which case the elements must be read one by one.
+ * Returns -1 if the OSC buffer bounds are exceeded.
+ */
+int tosc_getNextSpan(tosc_message *o, const char *format, tosc_span *s);
+
+/**
+ * Converts all elements of a span of 4-byte types ('i', 'f', 'c' or 'r') to
+ * host byte order. out must have room for s->count elements.
+ */
+void tosc_decodeInt32Span(const tosc_span *s, int32_t *out);
+void tosc_decodeFloatSpan(const tosc_span *s, float *out);
+
+/**
+ * Converts all elements of a span of 8-byte types ('h', 'd' or 't') to host
+ * byte order. out must have room for s->count elements.
+ */
+void tosc_decodeInt64Span(const tosc_span *s, int64_t *out);
+void tosc_decodeDoubleSpan(const tosc_span *s, double *out);
+
 /**
  * Resets the read head to the first element.
  *
@@ -129,6 +180,12 @@ unsigned char *tosc_getNextMidi(tosc_message *o);
  */
 tosc_message *tosc_reset(tosc_message *o);
 
+/**
+ * Returns a 32-bit FNV-1a hash of a null-terminated OSC address.
+ * Never returns 0, so that 0 can be used to mark empty hash table slots.
+ */
+uint32_t tosc_hashAddress(const char *address);
+
 /**
  * Parse a buffer containing an OSC message.
  * The contents of the buffer are NOT copied.
@@ -160,6 +217,12 @@ uint32_t tosc_getBundleLength(tosc_bundle *b);
 uint32_t tosc_writeMessage(char *buffer, const int len, const char *address,
     const char *fmt, ...);
 
+/**
+ * Same as tosc_writeMessage, but takes the arguments as a va_list.
+ */
+uint32_t tosc_vwriteMessage(char *buffer, const int len, const char *address,
+    const char *fmt, va_list ap);
+
 /**
  * A convenience function to (non-destructively) print a buffer containing
  * an OSC message to stdout.
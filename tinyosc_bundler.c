@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#if _WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+#include "tinyosc_bundler.h"
+
+static void tosc_openBundle(tosc_bundler *b) {
+  b->timetag = b->nextTimetag;
+  tosc_writeBundle(&b->bundle, b->timetag, b->bundle.buffer, b->mtu);
+  b->numPending = 0;
+}
+
+// accounts for a message of len bytes just written after the length prefix
+static void tosc_commitBundledMessage(tosc_bundler *b, uint64_t now,
+    const uint32_t len) {
+  *((uint32_t *) b->bundle.marker) = htonl(len);
+  b->bundle.marker += (4 + len);
+  b->bundle.bundleLen += (4 + len);
+  if (b->numPending++ == 0) b->deadline = now + b->latency;
+}
+
+bool tosc_initBundler(tosc_bundler *b, char *buffer, const uint32_t mtu,
+    uint64_t latency, tosc_bundlerFlushFn flush, void *userData) {
+  memset(b, 0, sizeof(tosc_bundler));
+  if (mtu < 20) return false; // the bundle header and one length prefix
+  b->bundle.buffer = buffer;
+  // keeps every message in the bundle 4 byte aligned, so that the padding
+  // written by tosc_vwriteMessage never goes past the end of the buffer
+  b->mtu = mtu & ~0x3;
+  b->latency = latency;
+  b->nextTimetag = TINYOSC_TIMETAG_IMMEDIATELY;
+  b->flush = flush;
+  b->userData = userData;
+  tosc_openBundle(b);
+  return true;
+}
+
+void tosc_setBundlerTimetag(tosc_bundler *b, uint64_t timetag) {
+  b->nextTimetag = timetag;
+  if (b->numPending == 0) tosc_openBundle(b);
+}
+
+int tosc_vwriteBundledMessage(tosc_bundler *b, uint64_t now,
+    const char *address, const char *format, va_list ap) {
+  tosc_pollBundler(b, now);
+  int32_t n = -1;
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    // the message must fit after its 4 byte length prefix
+    if (b->bundle.bundleLen + 4 < b->mtu) {
+      va_list aq;
+      va_copy(aq, ap);
+      n = (int32_t) tosc_vwriteMessage(b->bundle.marker+4,
+          b->mtu-b->bundle.bundleLen-4, address, format, aq);
+      va_end(aq);
+      if (n >= 0) {
+        tosc_commitBundledMessage(b, now, (uint32_t) n);
+        return n;
+      }
+    }
+    // an unknown type or a message which doesn't fit in an empty bundle
+    // won't be fixed by flushing
+    if (n == -4 || b->numPending == 0) break;
+    tosc_flushBundler(b);
+  }
+  return n;
+}
+
+int tosc_writeBundledMessage(tosc_bundler *b, uint64_t now,
+    const char *address, const char *format, ...) {
+  va_list ap;
+  va_start(ap, format);
+  const int n = tosc_vwriteBundledMessage(b, now, address, format, ap);
+  va_end(ap);
+  return n;
+}
+
+int tosc_appendBundledMessage(tosc_bundler *b, uint64_t now,
+    const char *message, const uint32_t len) {
+  if (16 + 4 + len > b->mtu) return -1; // would not fit in an empty bundle
+  if ((len & 0x3) != 0) return -1; // would misalign every later element
+  tosc_pollBundler(b, now);
+  if (b->bundle.bundleLen + 4 + len > b->mtu) tosc_flushBundler(b);
+  memcpy(b->bundle.marker+4, message, len);
+  tosc_commitBundledMessage(b, now, len);
+  return (int) len;
+}
+
+bool tosc_pollBundler(tosc_bundler *b, uint64_t now) {
+  if (b->numPending == 0 || now < b->deadline) return false;
+  tosc_flushBundler(b);
+  return true;
+}
+
+void tosc_flushBundler(tosc_bundler *b) {
+  if (b->numPending == 0) return;
+  b->flush(b->userData, b->bundle.buffer, b->bundle.bundleLen, b->timetag);
+  b->numMessages += b->numPending;
+  b->numPackets += 1;
+  b->numBytes += b->bundle.bundleLen;
+  tosc_openBundle(b);
+}
+
+bool tosc_getBundlerDeadline(tosc_bundler *b, uint64_t *deadline) {
+  if (b->numPending == 0) return false;
+  *deadline = b->deadline;
+  return true;
+}
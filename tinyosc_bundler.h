@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TINY_OSC_BUNDLER_
+#define _TINY_OSC_BUNDLER_
+
+#include "tinyosc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Called whenever a bundle is complete and should be sent.
+ */
+typedef void (*tosc_bundlerFlushFn)(void *userData,
+    const char *buffer, uint32_t len, uint64_t timetag);
+
+typedef struct tosc_bundler {
+  tosc_bundle bundle; // the bundle currently being filled
+  uint32_t mtu; // the maximum size in bytes of one bundle
+  uint32_t numPending; // the number of messages in the current bundle
+  uint64_t latency; // the maximum time a message may wait before being sent
+  uint64_t deadline; // the time at which the current bundle must be sent
+  uint64_t timetag; // the timetag of the current bundle
+  uint64_t nextTimetag; // the timetag of the following bundles
+  tosc_bundlerFlushFn flush; // sends a finished bundle
+  void *userData; // passed to the flush function
+
+  uint64_t numMessages; // total number of messages sent
+  uint64_t numPackets; // total number of bundles sent
+  uint64_t numBytes; // total number of bytes sent
+} tosc_bundler;
+
+/**
+ * Initialises a bundler which accumulates messages into bundles of at most
+ * mtu bytes, using the given buffer (at least mtu bytes long) as storage.
+ * mtu is rounded down to a multiple of 4, as OSC messages are padded to 4
+ * bytes. Returns false if mtu is less than 20 bytes, too small for any bundle.
+ * True otherwise.
+ * A bundle is handed to the flush function when it is full, when the oldest
+ * message in it has waited longer than latency, or on tosc_flushBundler.
+ * Times are given by the caller and may be in any unit, as long as it is the
+ * same for latency and for all now arguments.
+ */
+bool tosc_initBundler(tosc_bundler *b, char *buffer, const uint32_t mtu,
+    uint64_t latency, tosc_bundlerFlushFn flush, void *userData);
+
+/**
+ * Sets the timetag of bundles. Applies to the current bundle if it is still
+ * empty, otherwise to the bundles started after the next flush.
+ * The default is TINYOSC_TIMETAG_IMMEDIATELY.
+ */
+void tosc_setBundlerTimetag(tosc_bundler *b, uint64_t timetag);
+
+/**
+ * Writes a message into the current bundle, flushing first if it does not fit.
+ * Returns the number of bytes written. A negative number on error, e.g. if the
+ * message does not fit in an empty bundle.
+ */
+int tosc_writeBundledMessage(tosc_bundler *b, uint64_t now,
+    const char *address, const char *format, ...);
+
+/**
+ * Same as tosc_writeBundledMessage, but takes the arguments as a va_list.
+ */
+int tosc_vwriteBundledMessage(tosc_bundler *b, uint64_t now,
+    const char *address, const char *format, va_list ap);
+
+/**
+ * Copies an already encoded message (e.g. from tosc_writeMessage) into the
+ * current bundle, flushing first if it does not fit.
+ * Returns the number of bytes written, or -1 if the message can never fit
+ * or its length is not a multiple of 4, as OSC messages always are.
+ */
+int tosc_appendBundledMessage(tosc_bundler *b, uint64_t now,
+    const char *message, const uint32_t len);
+
+/**
+ * Flushes the current bundle if its deadline has passed.
+ * Returns true if a bundle was flushed. False otherwise.
+ */
+bool tosc_pollBundler(tosc_bundler *b, uint64_t now);
+
+/**
+ * Sends the current bundle now, if it contains any messages.
+ */
+void tosc_flushBundler(tosc_bundler *b);
+
+/**
+ * Returns true if the current bundle contains messages waiting to be sent,
+ * in which case deadline is set to the time at which they will be flushed.
+ */
+bool tosc_getBundlerDeadline(tosc_bundler *b, uint64_t *deadline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TINY_OSC_BUNDLER_
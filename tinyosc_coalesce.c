@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include "tinyosc_coalesce.h"
+
+void tosc_initCoalescer(tosc_coalescer *c, tosc_coalesceSlot *slots,
+    uint32_t *queue, const uint32_t numSlots,
+    tosc_coalescerEmitFn emit, void *userData) {
+  memset(c, 0, sizeof(tosc_coalescer));
+  memset(slots, 0, numSlots * sizeof(tosc_coalesceSlot));
+  c->slots = slots;
+  c->queue = queue;
+  c->numSlots = numSlots;
+  c->emit = emit;
+  c->userData = userData;
+}
+
+void tosc_setCoalescerPassthrough(tosc_coalescer *c,
+    const char **prefixes, const int numPrefixes) {
+  c->passthrough = prefixes;
+  c->numPassthrough = numPrefixes;
+}
+
+static bool tosc_isPassthrough(tosc_coalescer *c, const char *address) {
+  for (int i = 0; i < c->numPassthrough; ++i) {
+    const char *p = c->passthrough[i];
+    if (strncmp(address, p, strlen(p)) == 0) return true;
+  }
+  return false;
+}
+
+// Returns the slot for the given address, or NULL if the table is full.
+// Slots are never emptied, they only stop being queued, so that a steady set
+// of addresses always finds the same slots. A slot which is not queued may be
+// taken over by a new address.
+static tosc_coalesceSlot *tosc_findSlot(tosc_coalescer *c,
+    const char *address, const uint32_t hash) {
+  const uint32_t mask = c->numSlots - 1;
+  tosc_coalesceSlot *reusable = NULL;
+  for (uint32_t i = 0; i < c->numSlots; ++i) {
+    tosc_coalesceSlot *s = c->slots + ((hash + i) & mask);
+    if (s->hash == 0) {
+      // the end of the probe sequence, the address is not in the table
+      if (reusable == NULL) reusable = s;
+      break;
+    }
+    if (s->hash == hash && strcmp(s->buffer, address) == 0) return s;
+    if (reusable == NULL && !s->queued) reusable = s;
+  }
+  return reusable;
+}
+
+static void tosc_queueSlot(tosc_coalescer *c, tosc_coalesceSlot *s) {
+  if (!s->queued) {
+    s->queued = true;
+    c->queue[c->numQueued++] = (uint32_t) (s - c->slots);
+  }
+}
+
+static void tosc_emitCoalesced(tosc_coalescer *c,
+    const char *buffer, const uint32_t len) {
+  c->emit(c->userData, buffer, len);
+  c->numEmitted += 1;
+}
+
+// stores a complete message, whose address is null-terminated within len,
+// as the pending value of its address, or emits it right away
+static void tosc_storeCoalesced(tosc_coalescer *c, const char *message,
+    const uint32_t len) {
+  tosc_coalesceSlot *s = NULL;
+  const uint32_t hash = tosc_hashAddress(message);
+  if (!tosc_isPassthrough(c, message)) s = tosc_findSlot(c, message, hash);
+  if (s == NULL) {
+    tosc_emitCoalesced(c, message, len);
+  } else {
+    memcpy(s->buffer, message, len);
+    s->hash = hash;
+    s->len = len;
+    tosc_queueSlot(c, s);
+  }
+}
+
+int tosc_writeCoalescedMessage(tosc_coalescer *c,
+    const char *address, const char *format, ...) {
+  c->numWritten += 1;
+  // written aside first, so that a failed write leaves any pending value alone
+  va_list ap;
+  va_start(ap, format);
+  const int32_t n = (int32_t) tosc_vwriteMessage(c->scratch,
+      TINYOSC_COALESCE_SLOT_LEN, address, format, ap);
+  va_end(ap);
+  if (n > 0) tosc_storeCoalesced(c, c->scratch, (uint32_t) n);
+  return n;
+}
+
+int tosc_coalesceMessage(tosc_coalescer *c, const char *message,
+    const uint32_t len) {
+  if (len > TINYOSC_COALESCE_SLOT_LEN) return -1;
+  c->numWritten += 1;
+  // the address is read as a string, it must end within the message
+  if (len == 0 || memchr(message, '\0', len) == NULL) return -1;
+  tosc_storeCoalesced(c, message, len);
+  return (int) len;
+}
+
+uint32_t tosc_flushCoalescer(tosc_coalescer *c) {
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < c->numQueued; ++i) {
+    tosc_coalesceSlot *s = c->slots + c->queue[i];
+    if (s->len > 0) {
+      tosc_emitCoalesced(c, s->buffer, s->len);
+      ++n;
+    }
+    s->queued = false;
+    s->len = 0;
+  }
+  c->numQueued = 0;
+  return n;
+}
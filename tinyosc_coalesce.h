@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TINY_OSC_COALESCE_
+#define _TINY_OSC_COALESCE_
+
+#include "tinyosc.h"
+
+// the maximum size of one coalesced message
+#define TINYOSC_COALESCE_SLOT_LEN 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Called for each message leaving the coalescer.
+ */
+typedef void (*tosc_coalescerEmitFn)(void *userData,
+    const char *buffer, uint32_t len);
+
+typedef struct tosc_coalesceSlot {
+  uint32_t hash; // the hash of the address in buffer, 0 if the slot was never used
+  uint32_t len; // the length of the pending message, 0 if there is none
+  bool queued; // true if the slot is waiting for the next flush
+  char buffer[TINYOSC_COALESCE_SLOT_LEN]; // the newest message for this address
+} tosc_coalesceSlot;
+
+typedef struct tosc_coalescer {
+  tosc_coalesceSlot *slots; // the slot table, indexed by address hash
+  uint32_t *queue; // indices of queued slots, in order of first arrival
+  uint32_t numSlots; // the size of the slot table, a power of two
+  uint32_t numQueued; // the number of entries in queue
+  const char **passthrough; // address prefixes which are never coalesced
+  int numPassthrough; // the number of entries in passthrough
+  tosc_coalescerEmitFn emit; // sends a message on
+  void *userData; // passed to the emit function
+  char scratch[TINYOSC_COALESCE_SLOT_LEN]; // used to write passthrough messages
+
+  uint64_t numWritten; // total number of messages given to the coalescer
+  uint64_t numEmitted; // total number of messages emitted
+} tosc_coalescer;
+
+/**
+ * Initialises a coalescer which keeps only the newest message per address
+ * until the next flush. slots and queue must both have numSlots entries,
+ * and numSlots must be a power of two, ideally at least twice the number of
+ * distinct addresses expected.
+ */
+void tosc_initCoalescer(tosc_coalescer *c, tosc_coalesceSlot *slots,
+    uint32_t *queue, const uint32_t numSlots,
+    tosc_coalescerEmitFn emit, void *userData);
+
+/**
+ * Sets the list of address prefixes which must never be coalesced.
+ * Messages with a matching address are emitted immediately. The list is not
+ * copied and must outlive the coalescer.
+ */
+void tosc_setCoalescerPassthrough(tosc_coalescer *c,
+    const char **prefixes, const int numPrefixes);
+
+/**
+ * Writes a message, replacing any message still pending for the same address.
+ * Returns the number of bytes written. A negative number on error, e.g. if
+ * the message is too long for a slot, in which case a message still pending
+ * for the address is kept.
+ * If the slot table is full the message is emitted immediately.
+ */
+int tosc_writeCoalescedMessage(tosc_coalescer *c,
+    const char *address, const char *format, ...);
+
+/**
+ * Same as tosc_writeCoalescedMessage, but for an already encoded message.
+ * Returns the number of bytes written, or -1 if it is too long for a slot
+ * or its address is not null-terminated within len.
+ */
+int tosc_coalesceMessage(tosc_coalescer *c, const char *message,
+    const uint32_t len);
+
+/**
+ * Emits all pending messages in order of their first arrival since the last
+ * flush. Returns the number of messages emitted.
+ */
+uint32_t tosc_flushCoalescer(tosc_coalescer *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TINY_OSC_COALESCE_
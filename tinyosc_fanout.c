@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#if __linux__
+#define _GNU_SOURCE // sendmmsg
+#endif
+#include <errno.h>
+#include <string.h>
+#include "tinyosc_fanout.h"
+
+void tosc_initFanout(tosc_fanout *f, tosc_destination *destinations,
+    const int capacity, uint64_t backoff, uint64_t maxBackoff) {
+  memset(f, 0, sizeof(tosc_fanout));
+  f->destinations = destinations;
+  f->capacity = capacity;
+  f->backoff = backoff;
+  f->maxBackoff = maxBackoff;
+}
+
+int tosc_addFanoutDestination(tosc_fanout *f,
+    const struct sockaddr *addr, socklen_t addrLen) {
+  if (f->numDestinations >= f->capacity) return -1;
+  if (addrLen > sizeof(struct sockaddr_storage)) return -1;
+  tosc_destination *d = f->destinations + f->numDestinations;
+  memset(d, 0, sizeof(tosc_destination));
+  memcpy(&d->addr, addr, addrLen);
+  d->addrLen = addrLen;
+  return f->numDestinations++;
+}
+
+void tosc_removeFanoutDestination(tosc_fanout *f, const int index) {
+  if (index < 0 || index >= f->numDestinations) return;
+  f->destinations[index] = f->destinations[--f->numDestinations];
+}
+
+static void tosc_fanoutSucceeded(tosc_destination *d) {
+  d->numSent += 1;
+  d->numFailures = 0;
+}
+
+// only errors caused by the destination itself are charged to it. Anything
+// else (a full send buffer, no memory, a bad socket) would fail for every
+// destination alike, and must not put them all into backoff
+static bool tosc_isDestinationError(const int error) {
+  switch (error) {
+#if _WIN32
+    case WSAECONNRESET: // an ICMP port unreachable, for UDP
+    case WSAECONNREFUSED:
+    case WSAEHOSTUNREACH:
+    case WSAENETUNREACH:
+    case WSAEMSGSIZE:
+    case WSAEACCES:
+    case WSAEADDRNOTAVAIL:
+    case WSAEAFNOSUPPORT:
+#else
+    case ECONNREFUSED:
+    case EHOSTUNREACH:
+    case ENETUNREACH:
+    case EMSGSIZE:
+    case EACCES: // e.g. a broadcast address without SO_BROADCAST
+    case EPERM: // e.g. refused by a firewall rule
+    case EADDRNOTAVAIL:
+    case EAFNOSUPPORT:
+    case EDESTADDRREQ:
+#endif
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void tosc_socketFailed(tosc_fanout *f, const int error) {
+  f->numSocketErrors += 1;
+  f->lastSocketError = error;
+}
+
+static void tosc_fanoutFailed(tosc_fanout *f, tosc_destination *d,
+    const int error, uint64_t now) {
+  d->numDropped += 1;
+  d->lastError = error;
+  uint64_t backoff = f->backoff;
+  for (uint32_t i = 0; i < d->numFailures && backoff < f->maxBackoff; ++i) {
+    backoff <<= 1;
+  }
+  if (backoff > f->maxBackoff) backoff = f->maxBackoff;
+  d->backoffUntil = now + backoff;
+  d->numFailures += 1;
+}
+
+#if __linux__
+int tosc_sendFanout(tosc_fanout *f, int fd,
+    const char *buffer, const uint32_t len, uint64_t now) {
+  // all messages share the one iovec, the packet is never copied
+  struct iovec iov = {(void *) buffer, len};
+  struct mmsghdr msgs[TINYOSC_FANOUT_BATCH];
+  tosc_destination *batch[TINYOSC_FANOUT_BATCH];
+  int sent = 0;
+  int i = 0;
+  while (i < f->numDestinations) {
+    // collect the next batch of destinations which are not backing off
+    int n = 0;
+    for (; i < f->numDestinations && n < TINYOSC_FANOUT_BATCH; ++i) {
+      tosc_destination *d = f->destinations + i;
+      if (d->numFailures > 0 && now < d->backoffUntil) {
+        d->numSkipped += 1;
+        continue;
+      }
+      memset(&msgs[n], 0, sizeof(struct mmsghdr));
+      msgs[n].msg_hdr.msg_name = &d->addr;
+      msgs[n].msg_hdr.msg_namelen = d->addrLen;
+      msgs[n].msg_hdr.msg_iov = &iov;
+      msgs[n].msg_hdr.msg_iovlen = 1;
+      batch[n++] = d;
+    }
+
+    // sendmmsg stops at the first failing message, which is reported by the
+    // following call
+    int k = 0;
+    while (k < n) {
+      const int r = sendmmsg(fd, msgs+k, (unsigned int) (n-k), 0);
+      f->numSyscalls += 1;
+      if (r < 0) {
+        const int error = errno;
+        if (error == EINTR) continue;
+        if (!tosc_isDestinationError(error)) {
+          // the rest of the destinations would fail the same way
+          tosc_socketFailed(f, error);
+          return sent;
+        }
+        tosc_fanoutFailed(f, batch[k++], error, now);
+      } else {
+        for (int j = 0; j < r; ++j) tosc_fanoutSucceeded(batch[k++]);
+        sent += r;
+      }
+    }
+  }
+  return sent;
+}
+#else
+int tosc_sendFanout(tosc_fanout *f, int fd,
+    const char *buffer, const uint32_t len, uint64_t now) {
+  int sent = 0;
+  for (int i = 0; i < f->numDestinations; ++i) {
+    tosc_destination *d = f->destinations + i;
+    if (d->numFailures > 0 && now < d->backoffUntil) {
+      d->numSkipped += 1;
+      continue;
+    }
+    f->numSyscalls += 1;
+    if (sendto(fd, buffer, len, 0,
+        (const struct sockaddr *) &d->addr, d->addrLen) < 0) {
+#if _WIN32
+      const int error = WSAGetLastError();
+#else
+      const int error = errno;
+#endif
+      if (!tosc_isDestinationError(error)) {
+        tosc_socketFailed(f, error);
+        return sent;
+      }
+      tosc_fanoutFailed(f, d, error, now);
+    } else {
+      tosc_fanoutSucceeded(d);
+      ++sent;
+    }
+  }
+  return sent;
+}
+#endif
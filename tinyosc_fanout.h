@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TINY_OSC_FANOUT_
+#define _TINY_OSC_FANOUT_
+
+#if _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+#include "tinyosc.h"
+
+// the number of destinations handed to the kernel per sendmmsg call
+#define TINYOSC_FANOUT_BATCH 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tosc_destination {
+  struct sockaddr_storage addr; // the address of the destination
+  socklen_t addrLen; // the length of addr
+  uint32_t numFailures; // the number of consecutive failed sends
+  uint64_t backoffUntil; // the destination is skipped until this time
+  int lastError; // the errno of the last failed send
+  uint64_t numSent; // packets sent
+  uint64_t numDropped; // packets refused because of the destination
+  uint64_t numSkipped; // packets not sent because of backoff
+} tosc_destination;
+
+typedef struct tosc_fanout {
+  tosc_destination *destinations; // the destination list
+  int numDestinations; // the number of entries in use
+  int capacity; // the size of the destination list
+  uint64_t backoff; // the backoff after the first failure, doubled after each failure
+  uint64_t maxBackoff; // the maximum backoff
+  uint64_t numSyscalls; // total number of send system calls made
+  uint64_t numSocketErrors; // sends stopped by an error of the socket itself
+  int lastSocketError; // the errno of the last such error
+} tosc_fanout;
+
+/**
+ * Initialises a fan-out sender which sends the same packet to up to capacity
+ * destinations. A destination which fails is skipped for backoff, doubling
+ * with each consecutive failure up to maxBackoff. Times are given by the
+ * caller and may be in any unit.
+ */
+void tosc_initFanout(tosc_fanout *f, tosc_destination *destinations,
+    const int capacity, uint64_t backoff, uint64_t maxBackoff);
+
+/**
+ * Adds a destination. Returns its index, or -1 if the list is full.
+ */
+int tosc_addFanoutDestination(tosc_fanout *f,
+    const struct sockaddr *addr, socklen_t addrLen);
+
+/**
+ * Removes the destination at the given index. The last destination takes
+ * its place.
+ */
+void tosc_removeFanoutDestination(tosc_fanout *f, const int index);
+
+/**
+ * Sends an encoded packet (e.g. from tosc_writeMessage or a bundle) to all
+ * destinations which are not backing off, using as few system calls as
+ * possible (sendmmsg on Linux). Returns the number of destinations sent to.
+ *
+ * Only errors caused by a destination (e.g. ECONNREFUSED, EHOSTUNREACH,
+ * ENETUNREACH or EMSGSIZE) count as its failure and start its backoff. An
+ * error of the socket itself (e.g. EAGAIN, ENOBUFS or ENOMEM) stops the call,
+ * leaving the remaining destinations unsent and untouched, and is counted in
+ * numSocketErrors instead.
+ */
+int tosc_sendFanout(tosc_fanout *f, int fd,
+    const char *buffer, const uint32_t len, uint64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TINY_OSC_FANOUT_
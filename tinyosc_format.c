@@ -0,0 +1,310 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "tinyosc_format.h"
+
+// an output cursor which stops writing, but keeps counting, at the end of the buffer
+typedef struct tosc_writer {
+  char *buffer;
+  int len;
+  int pos;
+} tosc_writer;
+
+static void tosc_putChar(tosc_writer *w, const char c) {
+  if (w->pos < w->len - 1) w->buffer[w->pos] = c;
+  ++w->pos;
+}
+
+static void tosc_putString(tosc_writer *w, const char *s) {
+  while (*s != '\0') tosc_putChar(w, *s++);
+}
+
+static void tosc_putUint(tosc_writer *w, uint64_t k) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = (char) ('0' + (k % 10));
+    k /= 10;
+  } while (k != 0);
+  while (n > 0) tosc_putChar(w, digits[--n]);
+}
+
+static void tosc_putInt(tosc_writer *w, const int64_t k) {
+  if (k < 0) {
+    tosc_putChar(w, '-');
+    tosc_putUint(w, (uint64_t) 0 - (uint64_t) k);
+  } else {
+    tosc_putUint(w, (uint64_t) k);
+  }
+}
+
+static void tosc_putHex(tosc_writer *w, const uint32_t k, int numDigits) {
+  static const char hex[] = "0123456789ABCDEF";
+  while (numDigits-- > 0) tosc_putChar(w, hex[(k >> (4*numDigits)) & 0xF]);
+}
+
+// writes d with 6 significant digits, in the same notation as printf("%g")
+static void tosc_putDouble(tosc_writer *w, double d) {
+  if (d != d) { tosc_putString(w, "nan"); return; }
+  if (d < 0.0) { tosc_putChar(w, '-'); d = -d; }
+  if (d > 1.7976931348623157e308) { tosc_putString(w, "inf"); return; }
+  if (d == 0.0) { tosc_putChar(w, '0'); return; }
+
+  // scale d into [1, 10) with as few multiplications as possible
+  static const double pow10[] = {1e256, 1e128, 1e64, 1e32, 1e16, 1e8, 1e4, 1e2, 1e1};
+  static const int exp10[] = {256, 128, 64, 32, 16, 8, 4, 2, 1};
+  int e = 0;
+  for (int i = 0; i < 9; ++i) {
+    if (d >= pow10[i]) { d /= pow10[i]; e += exp10[i]; }
+  }
+  for (int i = 0; i < 9; ++i) {
+    if (d < 1.0 / pow10[i] * 10.0) { d *= pow10[i]; e -= exp10[i]; }
+  }
+
+  // the 6 significant digits, rounded
+  uint32_t m = (uint32_t) (d * 100000.0 + 0.5);
+  if (m >= 1000000) { m /= 10; ++e; }
+  char digits[6];
+  for (int i = 5; i >= 0; --i) { digits[i] = (char) ('0' + m % 10); m /= 10; }
+  int numDigits = 6;
+  while (numDigits > 1 && digits[numDigits-1] == '0') --numDigits;
+
+  if (e < -4 || e >= 6) {
+    tosc_putChar(w, digits[0]);
+    if (numDigits > 1) {
+      tosc_putChar(w, '.');
+      for (int i = 1; i < numDigits; ++i) tosc_putChar(w, digits[i]);
+    }
+    tosc_putChar(w, 'e');
+    tosc_putChar(w, (e < 0) ? '-' : '+');
+    if (e < 0) e = -e;
+    if (e < 10) tosc_putChar(w, '0');
+    tosc_putUint(w, (uint64_t) e);
+  } else if (e < 0) {
+    tosc_putString(w, "0.");
+    for (int i = -1; i > e; --i) tosc_putChar(w, '0');
+    for (int i = 0; i < numDigits; ++i) tosc_putChar(w, digits[i]);
+  } else {
+    for (int i = 0; i <= e; ++i) tosc_putChar(w, digits[i]);
+    if (numDigits > e + 1) {
+      tosc_putChar(w, '.');
+      for (int i = e + 1; i < numDigits; ++i) tosc_putChar(w, digits[i]);
+    }
+  }
+}
+
+// writes a character of text from the wire, escaping anything which is not
+// printable ASCII, and the backslash itself, as \xNN
+static void tosc_putTextChar(tosc_writer *w, const char c) {
+  const unsigned char u = (unsigned char) c;
+  if (u >= 0x20 && u < 0x7F && u != '\\') {
+    tosc_putChar(w, c);
+  } else {
+    tosc_putString(w, "\\x");
+    tosc_putHex(w, u, 2);
+  }
+}
+
+static void tosc_putText(tosc_writer *w, const char *s) {
+  while (*s != '\0') tosc_putTextChar(w, *s++);
+}
+
+// bytes from the wire need not be UTF-8, so everything outside of printable
+// ASCII is escaped as the code point of the same value, keeping the output valid
+static void tosc_putJsonString(tosc_writer *w, const char *s) {
+  tosc_putChar(w, '"');
+  for (; *s != '\0'; ++s) {
+    const unsigned char c = (unsigned char) *s;
+    if (c == '"' || c == '\\') {
+      tosc_putChar(w, '\\');
+      tosc_putChar(w, (char) c);
+    } else if (c < 0x20 || c >= 0x7F) {
+      tosc_putString(w, "\\u00");
+      tosc_putHex(w, c, 2);
+    } else {
+      tosc_putChar(w, (char) c);
+    }
+  }
+  tosc_putChar(w, '"');
+}
+
+static void tosc_putJsonDouble(tosc_writer *w, const double d) {
+  if (d != d || d > 1.7976931348623157e308 || d < -1.7976931348623157e308) {
+    tosc_putString(w, "null");
+  } else {
+    tosc_putDouble(w, d);
+  }
+}
+
+static int tosc_finish(tosc_writer *w) {
+  if (w->len <= 0) return -1;
+  if (w->pos < w->len) {
+    w->buffer[w->pos] = '\0';
+    return w->pos;
+  }
+  w->buffer[w->len-1] = '\0';
+  return -1;
+}
+
+int tosc_formatDouble(double d, char *buffer, const int len) {
+  tosc_writer w = {buffer, len, 0};
+  tosc_putDouble(&w, d);
+  return tosc_finish(&w);
+}
+
+int tosc_formatMessage(tosc_message *o, char *buffer, const int len) {
+  tosc_writer w = {buffer, len, 0};
+  tosc_message osc = *o; // read from a copy, so that o is not modified
+  tosc_reset(&osc);
+
+  tosc_putChar(&w, '[');
+  tosc_putUint(&w, osc.len);
+  tosc_putString(&w, " bytes] ");
+  tosc_putText(&w, tosc_getAddress(&osc));
+  tosc_putChar(&w, ' ');
+  tosc_putText(&w, tosc_getFormat(&osc));
+
+  for (int i = 0; osc.format[i] != '\0'; i++) {
+    tosc_putChar(&w, ' ');
+    switch (osc.format[i]) {
+      case 'b': {
+        const char *b = NULL; // will point to binary data
+        int n = 0; // takes the length of the blob
+        tosc_getNextBlob(&osc, &b, &n);
+        tosc_putChar(&w, '[');
+        tosc_putUint(&w, (uint64_t) n);
+        tosc_putChar(&w, ']');
+        for (int j = 0; j < n; ++j) tosc_putHex(&w, (unsigned char) b[j], 2);
+        break;
+      }
+      case 'm': {
+        unsigned char *m = tosc_getNextMidi(&osc);
+        if (m == NULL) {
+          tosc_putString(&w, "(null)");
+          break;
+        }
+        tosc_putString(&w, "0x");
+        for (int j = 0; j < 4; ++j) tosc_putHex(&w, m[j], 2);
+        break;
+      }
+      case 'f': tosc_putDouble(&w, tosc_getNextFloat(&osc)); break;
+      case 'd': tosc_putDouble(&w, tosc_getNextDouble(&osc)); break;
+      case 'i': tosc_putInt(&w, tosc_getNextInt32(&osc)); break;
+      case 'c': tosc_putTextChar(&w, tosc_getNextChar(&osc)); break;
+      case 'r': tosc_putString(&w, "0x"); tosc_putHex(&w, tosc_getNextRgba(&osc), 8); break;
+      case 'h': tosc_putInt(&w, tosc_getNextInt64(&osc)); break;
+      case 't': tosc_putUint(&w, tosc_getNextTimetag(&osc)); break;
+      case 's': {
+        const char *s = tosc_getNextString(&osc);
+        if (s != NULL) tosc_putText(&w, s);
+        else tosc_putString(&w, "(null)");
+        break;
+      }
+      case 'F': tosc_putString(&w, "false"); break;
+      case 'I': tosc_putString(&w, "inf"); break;
+      case 'N': tosc_putString(&w, "nil"); break;
+      case 'T': tosc_putString(&w, "true"); break;
+      case '[': tosc_putChar(&w, '['); break;
+      case ']': tosc_putChar(&w, ']'); break;
+      default:
+        tosc_putString(&w, "Unknown format: '");
+        tosc_putTextChar(&w, osc.format[i]);
+        tosc_putChar(&w, '\'');
+        break;
+    }
+  }
+  return tosc_finish(&w);
+}
+
+int tosc_formatMessageJson(tosc_message *o, char *buffer, const int len) {
+  tosc_writer w = {buffer, len, 0};
+  tosc_message osc = *o; // read from a copy, so that o is not modified
+  tosc_reset(&osc);
+
+  tosc_putString(&w, "{\"address\":");
+  tosc_putJsonString(&w, tosc_getAddress(&osc));
+  tosc_putString(&w, ",\"format\":");
+  tosc_putJsonString(&w, tosc_getFormat(&osc));
+  tosc_putString(&w, ",\"args\":[");
+
+  bool first = true; // no comma before the first element of an array
+  int depth = 0; // the number of open arrays, as tags from the wire may not be balanced
+  for (int i = 0; osc.format[i] != '\0'; i++) {
+    const char type = osc.format[i];
+    if (type == ']') {
+      if (depth == 0) continue; // nothing to close
+      tosc_putChar(&w, ']');
+      depth--;
+      first = false;
+      continue;
+    }
+    if (!first) tosc_putChar(&w, ',');
+    first = false;
+    switch (type) {
+      case 'b': {
+        const char *b = NULL;
+        int n = 0;
+        tosc_getNextBlob(&osc, &b, &n);
+        tosc_putChar(&w, '"');
+        for (int j = 0; j < n; ++j) tosc_putHex(&w, (unsigned char) b[j], 2);
+        tosc_putChar(&w, '"');
+        break;
+      }
+      case 'm': {
+        unsigned char *m = tosc_getNextMidi(&osc);
+        if (m == NULL) {
+          tosc_putString(&w, "null");
+          break;
+        }
+        tosc_putChar(&w, '[');
+        for (int j = 0; j < 4; ++j) {
+          if (j > 0) tosc_putChar(&w, ',');
+          tosc_putUint(&w, m[j]);
+        }
+        tosc_putChar(&w, ']');
+        break;
+      }
+      case 'f': tosc_putJsonDouble(&w, tosc_getNextFloat(&osc)); break;
+      case 'd': tosc_putJsonDouble(&w, tosc_getNextDouble(&osc)); break;
+      case 'i': tosc_putInt(&w, tosc_getNextInt32(&osc)); break;
+      case 'h': tosc_putInt(&w, tosc_getNextInt64(&osc)); break;
+      case 't': tosc_putUint(&w, tosc_getNextTimetag(&osc)); break;
+      case 'r': tosc_putUint(&w, tosc_getNextRgba(&osc)); break;
+      case 'c': {
+        const char s[2] = {tosc_getNextChar(&osc), '\0'};
+        tosc_putJsonString(&w, s);
+        break;
+      }
+      case 's': {
+        const char *s = tosc_getNextString(&osc);
+        if (s != NULL) tosc_putJsonString(&w, s);
+        else tosc_putString(&w, "null");
+        break;
+      }
+      case 'F': tosc_putString(&w, "false"); break;
+      case 'T': tosc_putString(&w, "true"); break;
+      case 'I': tosc_putString(&w, "\"inf\""); break;
+      case '[': tosc_putChar(&w, '['); depth++; first = true; break;
+      case 'N':
+      default: tosc_putString(&w, "null"); break;
+    }
+  }
+  for (; depth > 0; depth--) tosc_putChar(&w, ']'); // close any unterminated arrays
+  tosc_putString(&w, "]}");
+  return tosc_finish(&w);
+}
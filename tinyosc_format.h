@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TINY_OSC_FORMAT_
+#define _TINY_OSC_FORMAT_
+
+#include "tinyosc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Renders a message as a line of text into the given buffer, in the same
+ * format as tosc_printMessage but without the trailing newline. Numbers are
+ * converted without stdio. The message is not modified.
+ * Bytes of the address, format, strings and chars which are not printable
+ * ASCII, and the backslash, are written as \xNN, so the line is always plain text.
+ * Returns the number of characters written, not counting the terminating '\0'.
+ * Returns -1 if the buffer is too small, in which case it holds a truncated line.
+ */
+int tosc_formatMessage(tosc_message *o, char *buffer, const int len);
+
+/**
+ * Same as tosc_formatMessage, but renders the message as a single line of
+ * JSON: {"address":"/a","format":"fi","args":[1.5,2]}
+ * Blobs become hex strings, midi an array of 4 numbers, arrays nested arrays.
+ * Nil and non-finite floats become null. Unbalanced array tags are repaired,
+ * so that the output is always valid JSON. Control characters and all bytes
+ * from 0x7F up are written as \u00NN, as strings from the wire need not be
+ * UTF-8, so the output is always ASCII.
+ */
+int tosc_formatMessageJson(tosc_message *o, char *buffer, const int len);
+
+/**
+ * Writes a float in the style of printf("%g"), without stdio.
+ * Returns the number of characters written (at most 15), not counting the
+ * terminating '\0', or -1 if the buffer is too small.
+ */
+int tosc_formatDouble(double d, char *buffer, const int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TINY_OSC_FORMAT_
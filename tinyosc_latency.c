@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE // clock_gettime, SO_TIMESTAMPNS
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include "tinyosc_latency.h"
+
+// seconds between the NTP epoch (1900) and the unix epoch (1970)
+#define NTP_UNIX_OFFSET 2208988800ULL
+
+static uint64_t tosc_timespecToTimetag(const struct timespec *ts) {
+  const uint64_t seconds = (uint64_t) ts->tv_sec + NTP_UNIX_OFFSET;
+  const uint64_t fraction = ((uint64_t) ts->tv_nsec << 32) / 1000000000ULL;
+  return (seconds << 32) | fraction;
+}
+
+uint64_t tosc_getTimetagNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return tosc_timespecToTimetag(&ts);
+}
+
+double tosc_getTimetagDifference(uint64_t from, uint64_t to) {
+  // timetags are 32.32 fixed point seconds
+  return (double) (int64_t) (to - from) / 4294967296.0;
+}
+
+void tosc_writeStampedBundle(tosc_bundle *b, char *buffer, const int len) {
+  tosc_writeBundle(b, tosc_getTimetagNow(), buffer, len);
+}
+
+void tosc_stampBundle(char *buffer) {
+  // written big-endian byte by byte, as the buffer may not be aligned
+  const uint64_t t = tosc_getTimetagNow();
+  for (int i = 0; i < 8; ++i) buffer[8+i] = (char) (t >> (56 - 8*i));
+}
+
+int tosc_enableReceiveTimestamps(int fd) {
+#ifdef SO_TIMESTAMPNS
+  const int on = 1;
+  return setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+#else
+  return -1;
+#endif
+}
+
+int tosc_receiveTimestamped(int fd, char *buffer, const int len,
+    struct sockaddr *addr, socklen_t *addrLen, uint64_t *timetag) {
+  struct iovec iov = {buffer, (size_t) len};
+  // the cmsghdr member aligns the buffer for the headers read out of it
+  union {
+    char buf[CMSG_SPACE(sizeof(struct timespec))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = addr;
+  msg.msg_namelen = (addrLen != NULL) ? *addrLen : 0;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  const int n = (int) recvmsg(fd, &msg, 0);
+  if (n < 0) return n;
+  if (addrLen != NULL) *addrLen = msg.msg_namelen;
+
+  *timetag = 0;
+#ifdef SO_TIMESTAMPNS
+  for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c)) {
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+      struct timespec ts;
+      memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+      *timetag = tosc_timespecToTimetag(&ts);
+    }
+  }
+#endif
+  if (*timetag == 0) *timetag = tosc_getTimetagNow();
+  return n;
+}
+
+void tosc_initLatencyStats(tosc_latencyStats *s, tosc_latencySource *sources,
+    const int capacity) {
+  s->sources = sources;
+  s->numSources = 0;
+  s->capacity = capacity;
+}
+
+tosc_latencySource *tosc_findLatencySource(tosc_latencyStats *s,
+    const struct sockaddr *addr, socklen_t addrLen) {
+  for (int i = 0; i < s->numSources; ++i) {
+    tosc_latencySource *src = s->sources + i;
+    if (src->addrLen == addrLen && memcmp(&src->addr, addr, addrLen) == 0) return src;
+  }
+  return NULL;
+}
+
+tosc_latencySource *tosc_recordLatency(tosc_latencyStats *s,
+    const struct sockaddr *addr, socklen_t addrLen,
+    uint64_t sendTimetag, uint64_t receiveTimetag) {
+  if (sendTimetag == TINYOSC_TIMETAG_IMMEDIATELY) return NULL;
+  tosc_latencySource *src = tosc_findLatencySource(s, addr, addrLen);
+  if (src == NULL) {
+    if (s->numSources >= s->capacity || addrLen > sizeof(struct sockaddr_storage)) {
+      return NULL;
+    }
+    src = s->sources + s->numSources++;
+    memset(src, 0, sizeof(tosc_latencySource));
+    memcpy(&src->addr, addr, addrLen);
+    src->addrLen = addrLen;
+  }
+
+  const double latency = tosc_getTimetagDifference(sendTimetag, receiveTimetag);
+  src->count += 1;
+  if (src->count == 1) {
+    src->min = src->max = latency;
+  } else {
+    if (latency < src->min) src->min = latency;
+    if (latency > src->max) src->max = latency;
+    const double d = (latency > src->last) ? latency - src->last : src->last - latency;
+    src->jitter += (d - src->jitter) / 16.0;
+  }
+  src->last = latency;
+
+  // Welford's online mean and variance
+  const double delta = latency - src->mean;
+  src->mean += delta / (double) src->count;
+  src->m2 += delta * (latency - src->mean);
+
+  // negative latencies (from clock offsets) land in the first bucket
+  const double us = latency * 1000000.0;
+  int bucket = 0;
+  while (bucket < TINYOSC_LATENCY_BUCKETS - 1 && us >= (double) (1ULL << bucket)) {
+    ++bucket;
+  }
+  src->histogram[bucket] += 1;
+  return src;
+}
+
+double tosc_getLatencyStdDev(const tosc_latencySource *src) {
+  if (src->count < 2) return 0.0;
+  const double variance = src->m2 / (double) (src->count - 1);
+  // Newton's method, to avoid linking libm
+  double x = (variance > 1.0) ? variance : 1.0;
+  for (int i = 0; i < 64 && variance > 0.0; ++i) x = 0.5 * (x + variance / x);
+  return (variance > 0.0) ? x : 0.0;
+}
+
+double tosc_getLatencyPercentile(const tosc_latencySource *src, double p) {
+  if (src->count == 0) return 0.0;
+  const double target = p / 100.0 * (double) src->count;
+  uint64_t n = 0;
+  for (int i = 0; i < TINYOSC_LATENCY_BUCKETS; ++i) {
+    n += src->histogram[i];
+    if ((double) n >= target) return (double) (1ULL << i) / 1000000.0;
+  }
+  return src->max;
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TINY_OSC_LATENCY_
+#define _TINY_OSC_LATENCY_
+
+#include <sys/socket.h>
+#include "tinyosc.h"
+
+// the number of histogram buckets, bucket i counts latencies below 2^i microseconds
+#define TINYOSC_LATENCY_BUCKETS 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tosc_latencySource {
+  struct sockaddr_storage addr; // the address of the sender
+  socklen_t addrLen; // the length of addr
+  uint64_t count; // the number of measurements
+  double mean; // the mean one-way latency in seconds
+  double m2; // the sum of squared differences from the mean
+  double min; // the smallest latency in seconds
+  double max; // the largest latency in seconds
+  double jitter; // smoothed latency variation in seconds, as in RFC 3550
+  double last; // the previous latency in seconds
+  uint64_t histogram[TINYOSC_LATENCY_BUCKETS];
+} tosc_latencySource;
+
+typedef struct tosc_latencyStats {
+  tosc_latencySource *sources; // per-sender statistics
+  int numSources; // the number of sources in use
+  int capacity; // the size of the sources array
+} tosc_latencyStats;
+
+/**
+ * Returns the current wall clock time as an OSC timetag.
+ */
+uint64_t tosc_getTimetagNow(void);
+
+/**
+ * Converts the difference between two timetags to seconds.
+ */
+double tosc_getTimetagDifference(uint64_t from, uint64_t to);
+
+/**
+ * Starts writing a bundle stamped with the current time, for one-way latency
+ * measurement by the receiver.
+ */
+void tosc_writeStampedBundle(tosc_bundle *b, char *buffer, const int len);
+
+/**
+ * Overwrites the timetag of a finished bundle with the current time, e.g.
+ * right before it is sent. This measures the time spent queued as well.
+ */
+void tosc_stampBundle(char *buffer);
+
+/**
+ * Asks the kernel to timestamp received packets (SO_TIMESTAMPNS).
+ * Returns 0 if there is no error. A negative number if not supported.
+ */
+int tosc_enableReceiveTimestamps(int fd);
+
+/**
+ * Same as recvfrom, but also returns the time of arrival as a timetag. The
+ * kernel timestamp is used when enabled with tosc_enableReceiveTimestamps,
+ * otherwise the time at which the packet is read.
+ */
+int tosc_receiveTimestamped(int fd, char *buffer, const int len,
+    struct sockaddr *addr, socklen_t *addrLen, uint64_t *timetag);
+
+/**
+ * Initialises latency statistics for up to capacity senders.
+ */
+void tosc_initLatencyStats(tosc_latencyStats *s, tosc_latencySource *sources,
+    const int capacity);
+
+/**
+ * Records the latency of a bundle sent at sendTimetag and received at
+ * receiveTimetag. Bundles timetagged TINYOSC_TIMETAG_IMMEDIATELY are ignored.
+ * Returns the statistics of the sender, or NULL if there is no room for it.
+ */
+tosc_latencySource *tosc_recordLatency(tosc_latencyStats *s,
+    const struct sockaddr *addr, socklen_t addrLen,
+    uint64_t sendTimetag, uint64_t receiveTimetag);
+
+/**
+ * Returns the statistics of a sender, or NULL if none were recorded.
+ */
+tosc_latencySource *tosc_findLatencySource(tosc_latencyStats *s,
+    const struct sockaddr *addr, socklen_t addrLen);
+
+/**
+ * Returns the standard deviation of the latency of a sender in seconds.
+ */
+double tosc_getLatencyStdDev(const tosc_latencySource *src);
+
+/**
+ * Returns an upper bound in seconds of the given percentile (0-100) of the
+ * latency of a sender, from its histogram.
+ */
+double tosc_getLatencyPercentile(const tosc_latencySource *src, double p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TINY_OSC_LATENCY_
@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+#if !_WIN32
+#include <netinet/in.h>
+#endif
+#include "tinyosc_session.h"
+
+#define SESSION_IDLE_WINDOWS 60
+
+static uint32_t tosc_hashSockaddr(const tosc_sessionTable *t,
+    const struct sockaddr *addr, socklen_t addrLen) {
+  uint32_t h;
+  if (addr->sa_family == AF_INET && addrLen >= sizeof(struct sockaddr_in)) {
+    // only the address and port, without hashing all of sockaddr_in
+    const struct sockaddr_in *sin = (const struct sockaddr_in *) addr;
+    h = (uint32_t) sin->sin_addr.s_addr;
+    if (!t->addressOnly) h ^= (uint32_t) sin->sin_port << 16;
+    // murmur3 finalizer, so that all bytes of the address reach the low bits
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+  } else if (t->addressOnly && addr->sa_family == AF_INET6
+      && addrLen >= sizeof(struct sockaddr_in6)) {
+    const unsigned char *b = ((const struct sockaddr_in6 *) addr)->sin6_addr.s6_addr;
+    h = 0x811C9DC5;
+    for (int i = 0; i < 16; ++i) h = (h ^ b[i]) * 0x01000193;
+  } else {
+    const unsigned char *b = (const unsigned char *) addr;
+    h = 0x811C9DC5;
+    for (socklen_t i = 0; i < addrLen; ++i) h = (h ^ b[i]) * 0x01000193;
+  }
+  return (h == 0) ? 1 : h;
+}
+
+static bool tosc_isSameSockaddr(const tosc_sessionTable *t,
+    const tosc_session *s, const struct sockaddr *addr, socklen_t addrLen) {
+  if (addr->sa_family == AF_INET && s->addr.ss_family == AF_INET) {
+    const struct sockaddr_in *a = (const struct sockaddr_in *) addr;
+    const struct sockaddr_in *b = (const struct sockaddr_in *) &s->addr;
+    return a->sin_addr.s_addr == b->sin_addr.s_addr
+        && (t->addressOnly || a->sin_port == b->sin_port);
+  }
+  if (t->addressOnly && addr->sa_family == AF_INET6
+      && s->addr.ss_family == AF_INET6 && addrLen >= sizeof(struct sockaddr_in6)) {
+    const struct sockaddr_in6 *a = (const struct sockaddr_in6 *) addr;
+    const struct sockaddr_in6 *b = (const struct sockaddr_in6 *) &s->addr;
+    return memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+  }
+  return s->addrLen == addrLen && memcmp(&s->addr, addr, addrLen) == 0;
+}
+
+void tosc_initSessionTable(tosc_sessionTable *t, tosc_session *sessions,
+    const uint32_t numSlots, uint64_t window) {
+  memset(t, 0, sizeof(tosc_sessionTable));
+  memset(sessions, 0, numSlots * sizeof(tosc_session));
+  t->sessions = sessions;
+  t->numSlots = numSlots;
+  t->window = window;
+  t->idleTimeout = window * SESSION_IDLE_WINDOWS;
+}
+
+void tosc_setSessionRateLimit(tosc_sessionTable *t, const uint32_t limit,
+    const uint32_t burst) {
+  t->limit = limit;
+  t->burst = (burst > limit) ? burst : limit;
+  for (uint32_t i = 0; i < t->numSlots; ++i) t->sessions[i].tokens = t->burst;
+  t->overflow.tokens = t->burst;
+}
+
+void tosc_setSessionAddressOnly(tosc_sessionTable *t, const bool addressOnly) {
+  // existing sessions were hashed with the port, and could not be found again
+  memset(t->sessions, 0, t->numSlots * sizeof(tosc_session));
+  t->numSessions = 0;
+  t->addressOnly = addressOnly;
+  for (uint32_t i = 0; i < t->numSlots; ++i) t->sessions[i].tokens = t->burst;
+}
+
+static void tosc_startSession(tosc_sessionTable *t, tosc_session *s,
+    const struct sockaddr *addr, socklen_t addrLen, const uint32_t hash,
+    uint64_t now) {
+  memset(s, 0, sizeof(tosc_session));
+  memcpy(&s->addr, addr, addrLen);
+  s->addrLen = addrLen;
+  s->hash = hash;
+  s->windowStart = now;
+  s->lastSeen = now;
+  s->tokens = t->burst;
+}
+
+tosc_session *tosc_getSession(tosc_sessionTable *t,
+    const struct sockaddr *addr, socklen_t addrLen, uint64_t now) {
+  if (addrLen > sizeof(struct sockaddr_storage)) return NULL;
+  const uint32_t hash = tosc_hashSockaddr(t, addr, addrLen);
+  const uint32_t mask = t->numSlots - 1;
+  // slots are never emptied so that probe sequences stay intact,
+  // an idle session is replaced in place instead
+  tosc_session *idle = NULL;
+  // a session is always created within the probe limit, so it is found there
+  for (uint32_t i = 0; i < t->numSlots && i < TINYOSC_SESSION_MAX_PROBE; ++i) {
+    tosc_session *s = t->sessions + ((hash + i) & mask);
+    if (s->hash == 0) {
+      if (idle == NULL) {
+        idle = s;
+        t->numSessions += 1;
+      }
+      break;
+    }
+    if (s->hash == hash && tosc_isSameSockaddr(t, s, addr, addrLen)) return s;
+    if (idle == NULL && now - s->lastSeen > t->idleTimeout) idle = s;
+  }
+  if (idle != NULL) tosc_startSession(t, idle, addr, addrLen, hash, now);
+  return idle;
+}
+
+bool tosc_admitPacket(tosc_sessionTable *t,
+    const struct sockaddr *addr, socklen_t addrLen, const int len,
+    uint64_t now, tosc_session **session) {
+  tosc_session *s = tosc_getSession(t, addr, addrLen, now);
+  // senders which don't fit are limited together, so that filling the table
+  // is not a way around the limit
+  if (s == NULL) s = &t->overflow;
+  if (session != NULL) *session = s;
+
+  if (now - s->windowStart >= t->window) {
+    // refill the bucket once per elapsed window
+    const uint64_t windows = (now - s->windowStart) / t->window;
+    const uint64_t tokens = s->tokens + windows * t->limit;
+    s->tokens = (tokens > t->burst) ? t->burst : (uint32_t) tokens;
+    // a window without packets means a rate of 0
+    s->lastWindowPackets = (windows == 1) ? s->windowPackets : 0;
+    s->lastWindowBytes = (windows == 1) ? s->windowBytes : 0;
+    s->windowPackets = 0;
+    s->windowBytes = 0;
+    s->windowStart += windows * t->window;
+  }
+  s->lastSeen = now;
+
+  if (t->limit > 0) {
+    if (s->tokens == 0) {
+      s->numLimited += 1;
+      return false;
+    }
+    s->tokens -= 1;
+  }
+  s->windowPackets += 1;
+  s->windowBytes += (uint64_t) len;
+  s->numPackets += 1;
+  s->numBytes += (uint64_t) len;
+  return true;
+}
+
+void tosc_addSessionError(tosc_session *s) {
+  if (s != NULL) s->numErrors += 1;
+}
+
+tosc_session *tosc_getHottestSession(tosc_sessionTable *t) {
+  tosc_session *hottest = NULL;
+  for (uint32_t i = 0; i < t->numSlots; ++i) {
+    tosc_session *s = t->sessions + i;
+    if (s->hash == 0) continue;
+    if (hottest == NULL || s->lastWindowPackets > hottest->lastWindowPackets) hottest = s;
+  }
+  return hottest;
+}
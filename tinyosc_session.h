@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TINY_OSC_SESSION_
+#define _TINY_OSC_SESSION_
+
+#if _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+#include "tinyosc.h"
+
+// the number of slots searched for a sender, so that a full table costs no
+// more per packet than a busy one
+#define TINYOSC_SESSION_MAX_PROBE 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tosc_session {
+  uint32_t hash; // the hash of addr, 0 if the slot was never used
+  socklen_t addrLen; // the length of addr
+  uint64_t lastSeen; // the time of the last packet
+  uint64_t windowStart; // the start of the current rate window
+  uint32_t windowPackets; // packets received in the current window
+  uint64_t windowBytes; // bytes received in the current window
+  uint32_t lastWindowPackets; // packets received in the previous window
+  uint64_t lastWindowBytes; // bytes received in the previous window
+  uint32_t tokens; // packets which may still be admitted, with a rate limit
+  uint64_t numPackets; // total packets admitted
+  uint64_t numBytes; // total bytes admitted
+  uint64_t numErrors; // total packets which failed to parse
+  uint64_t numLimited; // total packets dropped by the rate limit
+  struct sockaddr_storage addr; // the address of the sender
+} tosc_session;
+
+typedef struct tosc_sessionTable {
+  tosc_session *sessions; // the slot table, indexed by address hash
+  uint32_t numSlots; // the size of the slot table, a power of two
+  uint32_t numSessions; // the number of slots in use
+  uint64_t window; // the length of a rate window
+  uint64_t idleTimeout; // sessions idle for longer may be replaced
+  uint32_t limit; // packets admitted per window, 0 for no limit
+  uint32_t burst; // the most tokens a session can save up
+  bool addressOnly; // senders are told apart by address alone, not by port
+  tosc_session overflow; // shared by all senders which find the table full
+} tosc_sessionTable;
+
+/**
+ * Initialises a table of per-sender sessions using numSlots caller-provided
+ * slots. numSlots must be a power of two. Rates are counted over windows of
+ * the given length. Times are given by the caller in any unit, e.g. with a
+ * window of one second the rates are per second. Sessions idle for more than
+ * 60 windows may be replaced by new senders.
+ */
+void tosc_initSessionTable(tosc_sessionTable *t, tosc_session *sessions,
+    const uint32_t numSlots, uint64_t window);
+
+/**
+ * Limits every sender to limit packets per window, with up to burst packets
+ * saved up from quieter windows. A limit of 0 removes the limit.
+ * Senders which find the table full share a single limit between them.
+ */
+void tosc_setSessionRateLimit(tosc_sessionTable *t, const uint32_t limit,
+    const uint32_t burst);
+
+/**
+ * Tells IPv4 and IPv6 senders apart by address alone, ignoring the port.
+ * Otherwise a single host can send from many ports, each with a limit of
+ * its own, and fill the table. Clears the table.
+ */
+void tosc_setSessionAddressOnly(tosc_sessionTable *t, const bool addressOnly);
+
+/**
+ * Returns the session of a sender, creating it if needed.
+ * Returns NULL if the table is full, or if the TINYOSC_SESSION_MAX_PROBE
+ * slots following the sender's hash are all held by active senders.
+ */
+tosc_session *tosc_getSession(tosc_sessionTable *t,
+    const struct sockaddr *addr, socklen_t addrLen, uint64_t now);
+
+/**
+ * Accounts for a packet of len bytes from the given sender, before parsing.
+ * Returns false if the sender exceeded its rate limit and the packet should
+ * be dropped. session is set to the session of the sender, or to the shared
+ * overflow session of the table if the table is full.
+ */
+bool tosc_admitPacket(tosc_sessionTable *t,
+    const struct sockaddr *addr, socklen_t addrLen, const int len,
+    uint64_t now, tosc_session **session);
+
+/**
+ * Counts a packet from this session which could not be parsed.
+ */
+void tosc_addSessionError(tosc_session *s);
+
+/**
+ * Returns the session which received the most packets in its previous rate
+ * window, or NULL if there are no sessions.
+ */
+tosc_session *tosc_getHottestSession(tosc_sessionTable *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TINY_OSC_SESSION_
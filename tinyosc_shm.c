@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#if __linux__
+#define _GNU_SOURCE // syscall, shm_open
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "tinyosc_shm.h"
+
+#define SHM_MAGIC 0x746F7363 // "tosc"
+#define SHM_WRAP 0xFFFFFFFF // record length marking the end of the ring
+
+// Each record is an 8 byte header holding the packet length, followed by
+// the packet, padded to a multiple of 8 so that packets stay aligned.
+struct tosc_shmHeader {
+  uint32_t magic;
+  uint32_t capacity;
+  char pad0[56];
+  uint64_t head; // total bytes written, only changed by the producer
+  uint32_t seq; // futex word, incremented on every commit
+  char pad1[52];
+  uint64_t tail; // total bytes read, only changed by the consumer
+  uint32_t waiting; // true while the consumer may be sleeping
+  char pad2[52];
+};
+
+static uint32_t tosc_recordLen(const uint32_t len) {
+  return 8 + ((len + 7) & ~0x7);
+}
+
+int tosc_openShm(tosc_shm *s, const char *name, uint32_t capacity,
+    const bool create) {
+  memset(s, 0, sizeof(tosc_shm));
+  // rounding up any larger capacity to a power of two would overflow
+  if (create && capacity > TINYOSC_SHM_MAX_CAPACITY) {
+    s->fd = -1;
+    return -1;
+  }
+  // an existing ring is never reinitialised under a peer which is using it
+  s->fd = shm_open(name, create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+  if (s->fd < 0) return -1;
+
+  if (create) {
+    uint32_t c = 64;
+    while (c < capacity) c <<= 1;
+    capacity = c;
+    s->mapLen = sizeof(struct tosc_shmHeader) + capacity;
+    if (ftruncate(s->fd, (off_t) s->mapLen) != 0) {
+      close(s->fd);
+      return -2;
+    }
+  } else {
+    struct stat st;
+    if (fstat(s->fd, &st) != 0 || st.st_size <= sizeof(struct tosc_shmHeader)) {
+      close(s->fd);
+      return -2;
+    }
+    s->mapLen = (size_t) st.st_size;
+  }
+
+  void *p = mmap(NULL, s->mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+  if (p == MAP_FAILED) {
+    close(s->fd);
+    return -3;
+  }
+  s->header = (struct tosc_shmHeader *) p;
+  s->data = (char *) p + sizeof(struct tosc_shmHeader);
+
+  if (create) {
+    memset(s->header, 0, sizeof(struct tosc_shmHeader));
+    s->header->capacity = capacity;
+    __atomic_store_n(&s->header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+  } else if (__atomic_load_n(&s->header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC
+      || s->header->capacity < 64
+      || (s->header->capacity & (s->header->capacity - 1)) != 0
+      || sizeof(struct tosc_shmHeader) + s->header->capacity > s->mapLen) {
+    tosc_closeShm(s, name, false);
+    return -4;
+  }
+  s->capacity = s->header->capacity;
+  return 0;
+}
+
+void tosc_closeShm(tosc_shm *s, const char *name, const bool unlink) {
+  if (s->header != NULL) munmap(s->header, s->mapLen);
+  if (s->fd >= 0) close(s->fd);
+  if (unlink) shm_unlink(name);
+  s->header = NULL;
+  s->fd = -1;
+}
+
+char *tosc_reserveShm(tosc_shm *s, const uint32_t len) {
+  struct tosc_shmHeader *h = s->header;
+  const uint64_t head = h->head;
+  const uint64_t tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+  const uint32_t need = tosc_recordLen(len);
+  const uint32_t offset = (uint32_t) (head & (s->capacity - 1));
+  // records never wrap around, the rest of the ring is skipped instead
+  const uint32_t skip = (offset + need > s->capacity) ? s->capacity - offset : 0;
+  if (head + skip + need - tail > s->capacity) {
+    s->numDropped += 1;
+    return NULL;
+  }
+  // the marker is published together with the record, in tosc_commitShm
+  if (skip > 0) *((uint32_t *) (s->data + offset)) = SHM_WRAP;
+  s->reservedHead = head + skip;
+  s->reserved = len;
+  return s->data + (s->reservedHead & (s->capacity - 1)) + 8;
+}
+
+void tosc_commitShm(tosc_shm *s, uint32_t len) {
+  struct tosc_shmHeader *h = s->header;
+  if (len > s->reserved) len = s->reserved;
+  *((uint32_t *) (s->data + (s->reservedHead & (s->capacity - 1)))) = len;
+  __atomic_store_n(&h->head, s->reservedHead + tosc_recordLen(len),
+      __ATOMIC_RELEASE);
+  __atomic_add_fetch(&h->seq, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&h->waiting, __ATOMIC_SEQ_CST)) {
+    syscall(SYS_futex, &h->seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+}
+
+int tosc_sendShm(tosc_shm *s, const char *buffer, const uint32_t len) {
+  char *p = tosc_reserveShm(s, len);
+  if (p == NULL) return -1;
+  memcpy(p, buffer, len);
+  tosc_commitShm(s, len);
+  return (int) len;
+}
+
+int tosc_receiveShm(tosc_shm *s, char **buffer, const int timeoutMs) {
+  struct tosc_shmHeader *h = s->header;
+  // release the packet returned by the previous call
+  uint64_t tail = h->tail + s->readLen;
+  s->readLen = 0;
+  __atomic_store_n(&h->tail, tail, __ATOMIC_RELEASE);
+
+  uint64_t head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+  if (head == tail) {
+    if (timeoutMs == 0) return 0;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    __atomic_store_n(&h->waiting, 1, __ATOMIC_SEQ_CST);
+    // a wake meant for an earlier wait can arrive late, so the wait is
+    // repeated until there is a packet or the timeout has really passed
+    while (true) {
+      const uint32_t seq = __atomic_load_n(&h->seq, __ATOMIC_SEQ_CST);
+      head = __atomic_load_n(&h->head, __ATOMIC_SEQ_CST);
+      if (head != tail) break;
+      struct timespec ts = {0, 0};
+      if (timeoutMs > 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        ts.tv_sec = deadline.tv_sec - now.tv_sec;
+        ts.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (ts.tv_nsec < 0) {
+          ts.tv_sec -= 1;
+          ts.tv_nsec += 1000000000L;
+        }
+        if (ts.tv_sec < 0) break;
+      }
+      syscall(SYS_futex, &h->seq, FUTEX_WAIT, seq,
+          (timeoutMs < 0) ? NULL : &ts, NULL, 0);
+    }
+    __atomic_store_n(&h->waiting, 0, __ATOMIC_RELAXED);
+    if (head == tail) return 0;
+  }
+
+  uint32_t offset = (uint32_t) (tail & (s->capacity - 1));
+  uint32_t len = *((uint32_t *) (s->data + offset));
+  if (len == SHM_WRAP) {
+    tail += s->capacity - offset;
+    __atomic_store_n(&h->tail, tail, __ATOMIC_RELEASE);
+    offset = 0;
+    len = *((uint32_t *) s->data);
+  }
+  // a record running past the end of the ring can only come from a broken
+  // producer, and would point the consumer outside of the mapping
+  if (len > s->capacity - offset - 8) return -1;
+  *buffer = s->data + offset + 8;
+  s->readLen = tosc_recordLen(len);
+  return (int) len;
+}
+#endif // __linux__
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2015-2018, Martin Roth (mhroth@gmail.com)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+ * LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TINY_OSC_SHM_
+#define _TINY_OSC_SHM_
+
+#include "tinyosc.h"
+
+#if __linux__
+
+// the largest ring, capacities are rounded up to a power of two
+#define TINYOSC_SHM_MAX_CAPACITY 0x80000000u
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A single-producer single-consumer ring of OSC packets in shared memory,
+ * for processes on the same host (Linux only). Packets are written and read
+ * in place. A consumer blocked in tosc_receiveShm is woken through a futex
+ * in the shared memory.
+ */
+typedef struct tosc_shm {
+  struct tosc_shmHeader *header; // the shared ring state
+  char *data; // the ring buffer, following the header
+  uint32_t capacity; // the size in bytes of the ring buffer, a power of two
+  uint32_t reserved; // the size of the space returned by tosc_reserveShm
+  uint64_t reservedHead; // the position of the reserved record in the ring
+  uint64_t readLen; // the size of the record returned by the last receive
+  uint64_t numDropped; // packets not sent because the ring was full
+  size_t mapLen; // the size of the mapping
+  int fd; // the shared memory file descriptor
+} tosc_shm;
+
+/**
+ * Opens the ring with the given name (e.g. "/tinyosc"), creating it with
+ * capacity bytes (rounded up to a power of two) if create is true.
+ * A capacity above TINYOSC_SHM_MAX_CAPACITY is rejected.
+ * Creating fails if the name already exists, so that a ring in use is never
+ * reset. A ring left behind by a process which exited without unlinking it
+ * must be removed first, e.g. with shm_unlink.
+ * Returns 0 if there is no error. A negative number otherwise.
+ */
+int tosc_openShm(tosc_shm *s, const char *name, uint32_t capacity,
+    const bool create);
+
+/**
+ * Unmaps the ring. If unlink is true the name is also removed.
+ */
+void tosc_closeShm(tosc_shm *s, const char *name, const bool unlink);
+
+/**
+ * Returns a pointer into the ring where a packet of at most len bytes can be
+ * written, e.g. with tosc_writeMessage or tosc_writeBundle, or NULL if the
+ * ring is full. The packet is published with tosc_commitShm.
+ */
+char *tosc_reserveShm(tosc_shm *s, const uint32_t len);
+
+/**
+ * Publishes the packet written to the space returned by tosc_reserveShm,
+ * with its final length (at most the reserved length).
+ */
+void tosc_commitShm(tosc_shm *s, uint32_t len);
+
+/**
+ * Copies a packet into the ring. Returns len, or -1 if the ring is full.
+ */
+int tosc_sendShm(tosc_shm *s, const char *buffer, const uint32_t len);
+
+/**
+ * Points buffer to the next packet in the ring, waiting for up to timeoutMs
+ * milliseconds (0 does not wait, a negative number waits forever).
+ * Returns the length of the packet, 0 if there is none, or -1 if the ring
+ * is corrupt.
+ * The packet can be parsed in place and stays valid until the next call,
+ * in the same way as a packet read with recvfrom:
+ *
+ *   while ((len = tosc_receiveShm(&shm, &buffer, 0)) > 0) { ... }
+ */
+int tosc_receiveShm(tosc_shm *s, char **buffer, const int timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __linux__
+
+#endif // _TINY_OSC_SHM_